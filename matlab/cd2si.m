@@ -21,11 +21,7 @@ function [si] = cd2si(d,bit,fracbit)
 %
 % May 2004; Last revision: 27-May-2014
 
-max = 2^bit / 2 - 1;
-min = - 2^bit / 2;
-
-d = round(d.*2^fracbit);
-
-si = d.*((d <= max) & (d >= min)) + max .* (d > max) + min .* (d < min);
+% The conversion is done in one pass by the mex file
+si = mtca4u_mex('cd2si', d, bit, fracbit);
 
 end
@@ -21,14 +21,8 @@ function [ui] = cd2ui(d,bit,fracbit)
 %
 % May 2004; Last revision: 27-May-2014
 
-max = 2^bit / 2 - 1;
-min = - 2^bit / 2;
-
-d = round(d.*2^fracbit);
-
-d = d.*((d <= max) & (d >= min)) + max .* (d > max) + min .* (d < min); 
-
-ui = d.*(d >= 0) + (d+(2^bit)).*(d < 0);
+% The conversion is done in one pass by the mex file
+ui = mtca4u_mex('cd2ui', d, bit, fracbit);
 
 end
 
@@ -21,13 +21,7 @@ function [d] = csi2d(i,bit,fracbit)
 %
 % May 2004; Last revision: 27-May-2014
 
-max = 2^bit / 2 - 1;
-min = - 2^bit / 2;
-
-i = round(i);
-
-i = i.*((i <= max) & (i >= min)) + max .* (i > max) + min .* (i < min);
-
-d = i ./ 2^fracbit;
+% The conversion is done in one pass by the mex file
+d = mtca4u_mex('csi2d', i, bit, fracbit);
 
 end
\ No newline at end of file
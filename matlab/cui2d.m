@@ -21,15 +21,7 @@ function [d] = cui2d(ui,bit,fracbit)
 %
 % May 2004; Last revision: 27-May-2014
 
-max = 2^bit - 1;
-half = 2^bit / 2 -1;
-
-ui = round(ui);
-
-ui = ui.*((ui <= max) & (ui >= 0)) + max .* (ui > max) + 0 .* (ui < 0);
-
-i = ui.*(ui <= half) + (ui-max-1).*(ui>half);
-
-d = i ./ 2^fracbit;
+% The conversion is done in one pass by the mex file
+d = mtca4u_mex('cui2d', ui, bit, fracbit);
 
 end
\ No newline at end of file
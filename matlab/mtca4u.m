@@ -6,16 +6,39 @@ classdef mtca4u < mtca4u_interface
   %  setDMapFilePath - Sets the DMap file which will be used
   %  getDMapFilePath - Displays the current used DMap file
   %  print_info - Displays all available boards with additional information
+  %  record_open - Reads a recording written by record_start
+  %  stats - Returns the performance counters of the mex commands
+  %  stats_reset - Clears the performance counters
+  %  trace_start - Starts tracing the single calls into a ring buffer
+  %  trace_stop - Stops tracing
+  %  trace_dump - Writes the trace as Chrome trace-event JSON
+  %  read_multi_device - Reads the same register from several boards concurrently
   %
   % mtca4u Methods (class):
   %   print_device_info - Displays all available registers of a board
+  %   device_info - Returns the information of all registers of a board
   %   print_register_info - Displays all information of a certain register
   %   get_register_size - Returns the size of a register
+  %   find_registers - Returns the names of the registers matching a pattern
   %   read - Reads data from the register of a board
   %   write - Writes data to the register of a board
+  %   write_raw - Writes raw data or fixed point values to the register of a board
   %   read_dma_raw - Reads raw data from a board using direct memory access
   %   read_dma - Reads data from a board using direct memory access
   %   read_seq - Reads a sequence from the dma area
+  %   read_wait - Reads a register when its next update has been pushed
+  %   read_many - Reads several registers in one transfer group
+  %   read_async - Starts a read in the background and returns a ticket
+  %   read_ready - Checks if the read of a ticket has finished
+  %   read_fetch - Returns the data of a ticket
+  %   acq_start - Starts reading a register continuously in the background
+  %   acq_fetch - Returns the blocks of a background acquisition
+  %   acq_stop - Stops a background acquisition
+  %   record_start - Starts recording registers to a binary file
+  %   record_stop - Stops a recording
+  %   resolve - Resolves a register once and returns a handle
+  %   read_h - Reads data through a register handle
+  %   write_h - Writes data through a register handle
   %
   % Example:
   %   mtca4u.version();
@@ -90,11 +113,155 @@ classdef mtca4u < mtca4u_interface
         end
 		end						
 		
+    function rec = record_open(varargin)
+        %mtca4u.record_open - Reads a recording written by record_start
+        %
+        % Syntax:
+        %    rec = mtca4u.record_open(file)
+        %    rec = mtca4u.record_open(file, offset, blocks)
+        %
+        % Inputs:
+        %    file - Name of the recording file
+        %    offset - Index of the first block to be read, starting at 0 (optional)
+        %    blocks - Number of blocks to be read (optional, default: all remaining)
+        %
+        % Outputs:
+        %    rec - Struct with the register descriptions and the number of blocks. With a
+        %          block range it also holds the timestamps and for each register an
+        %          elements x channels x blocks array.
+        %
+        % See also: mtca4u, mtca4u.record_start
+        try
+          rec = mtca4u_mex('record_open', varargin{:});
+        catch ex
+          error(ex.message)
+        end
+    end
+
+    function s = stats()
+        %mtca4u.stats - Returns the performance counters of the mex commands
+        %
+        % Syntax:
+        %    s = mtca4u.stats()
+        %
+        % Outputs:
+        %    s - Struct with the fields
+        %        commands - per command the number of calls and the time statistics
+        %                   (count, total, min, max, histogram in seconds) of the whole
+        %                   call and of the phases parse, setup, transfer and conversion
+        %        transfers - per device handle and register the transfers and bytes
+        %        histogram_edges - upper bounds of the histogram bins in seconds
+        %
+        % See also: mtca4u, mtca4u.stats_reset
+        try
+          s = mtca4u_mex('stats');
+        catch ex
+          error(ex.message)
+        end
+    end
+
+    function stats_reset()
+        %mtca4u.stats_reset - Clears the performance counters
+        %
+        % Syntax:
+        %    mtca4u.stats_reset()
+        %
+        % See also: mtca4u, mtca4u.stats
+        try
+          mtca4u_mex('stats_reset');
+        catch ex
+          error(ex.message)
+        end
+    end
+
+    function trace_start(varargin)
+        %mtca4u.trace_start - Starts tracing the single calls into a ring buffer
+        %
+        % Syntax:
+        %    mtca4u.trace_start()
+        %    mtca4u.trace_start(capacity)
+        %
+        % Inputs:
+        %    capacity - Number of records kept, older ones are overwritten (optional,
+        %               default: 65536). A call takes one record plus one per phase,
+        %               device lookup and transferred register.
+        %
+        % See also: mtca4u, mtca4u.trace_stop, mtca4u.trace_dump
+        try
+          mtca4u_mex('trace_start', varargin{:});
+        catch ex
+          error(ex.message)
+        end
+    end
+
+    function trace_stop()
+        %mtca4u.trace_stop - Stops tracing, the records are kept for trace_dump
+        %
+        % Syntax:
+        %    mtca4u.trace_stop()
+        %
+        % See also: mtca4u, mtca4u.trace_start, mtca4u.trace_dump
+        try
+          mtca4u_mex('trace_stop');
+        catch ex
+          error(ex.message)
+        end
+    end
+
+    function n = trace_dump(file)
+        %mtca4u.trace_dump - Writes the trace as Chrome trace-event JSON
+        %
+        % Syntax:
+        %    n = mtca4u.trace_dump(file)
+        %
+        % Inputs:
+        %    file - Name of the JSON file, which can be opened in chrome://tracing or Perfetto
+        %
+        % Outputs:
+        %    n - Number of events written
+        %
+        % See also: mtca4u, mtca4u.trace_start, mtca4u.stats
+        try
+          n = mtca4u_mex('trace_dump', file);
+        catch ex
+          error(ex.message)
+        end
+    end
+
+    function data = read_multi_device(boards, varargin)
+        %mtca4u.read_multi_device - Reads the same register from several boards concurrently
+        %
+        % Syntax:
+        %    data = mtca4u.read_multi_device([board1, board2, ...], module, register)
+        %    data = mtca4u.read_multi_device([board1, board2, ...], module, register, offset, elements)
+        %
+        % Inputs:
+        %    boards - Array of mtca4u objects
+        %    module - Name of the module
+        %    register - Name of the register
+        %    offset - Index of the first element (optional, default: 0)
+        %    elements - Number of elements (optional, default: all remaining)
+        %
+        % Outputs:
+        %    data - elements x boards matrix, one column per board
+        %
+        % See also: mtca4u, mtca4u.read
+        try
+          data = mtca4u_mex('read_multi_device', [boards.handle], varargin{:});
+        catch ex
+          error(ex.message)
+        end
+    end
+
 		function print_info(~, varargin)
         %mtca4u.print_info - Displays all available boards with additional information
         %
         % Syntax:
         %    mtca4u.print_info()
+        %    mtca4u.print_info([], timeout)
+        %
+        % Inputs:
+        %    timeout - Time in seconds to wait for the devices to answer (optional, default: 2)
         %
         % See also: mtca4u, mtca4u.read
             try
@@ -158,6 +325,28 @@ classdef mtca4u < mtca4u_interface
             %end
         end
 
+        function info = device_info(obj, varargin)
+        %mtca4u.device_info - Returns the information of all registers of a board
+        %
+        % Syntax:
+        %    % board = mtca4u('board');
+        %    info = board.device_info()
+        %    info = board.device_info('columns')
+        %
+        % Inputs:
+        %    'columns' - Return one struct with a column per field instead of a
+        %                struct array, e.g. for struct2table (optional)
+        %
+        % Outputs:
+        %    info - Register names, sizes, types and flags
+        %
+            try
+                info = mtca4u_mex('device_info', obj.handle, varargin{:});
+            catch ex
+                error(ex.message);
+            end
+        end
+
         function print_register_info(obj, varargin)
         %mtca4u.print_register_info - Displays all information of a certain register
         %
@@ -199,6 +388,28 @@ classdef mtca4u < mtca4u_interface
             end
         end
 
+        function names = find_registers(obj, varargin)
+        %mtca4u.find_registers - Returns the names of the registers matching a pattern
+        %
+        % Syntax:
+        %    % board = mtca4u('board');
+        %    names = board.find_registers(pattern)
+        %    names = board.find_registers(pattern, mode)
+        %
+        % Inputs:
+        %    pattern - Pattern of the register path, e.g. 'BOARD0/WORD_*'
+        %    mode - 'glob' (default, '*' does not match '/') or 'regex'
+        %
+        % Outputs:
+        %    names - Cell array with the full register paths
+        %
+            try
+                names = mtca4u_mex('find_registers', obj.handle, varargin{:});
+            catch ex
+                error(ex.message);
+            end
+        end
+
 
         function varargout = read(obj, varargin)
         %mtca4u.read - Reads data from the register of a board
@@ -207,6 +418,9 @@ classdef mtca4u < mtca4u_interface
         %    % board = mtca4u('board'); 
         %    [data] = board.read(module, register)
         %    [data] = d.read(module, register, offset, elements)
+        %    [data] = d.read(module, register, offset, elements, class)
+        %    [data] = d.read(module, register, class)
+        %    [data] = d.read(module, register, offset, elements, {'mean', 100})
         %    ...
         %
         % Inputs:
@@ -214,6 +428,13 @@ classdef mtca4u < mtca4u_interface
         %    register - Name of the register
 	     %    offset - Start element of the reading (optional, default: 1)
         %    elements - Number of elements to be read (optional, default: 'numel(offset:end)')
+        %    class - Class of the output: 'double', 'single', 'int8' ... 'uint64' or 'native'
+        %            for the smallest class holding the register values (optional, default: 'double')
+        %    reduction - Returns only reduced data (optional, always the last argument):
+        %                {'decimate', n} every n-th value in the class of the output,
+        %                {'mean', n} or {'rms', n} of blocks of n values,
+        %                {'minmax', n} 2 x n matrix of the minima and maxima of n bins,
+        %                {'histogram', edges} counts of edges(i) <= value < edges(i+1)
         %
         % Outputs:
         %    data - Value/s of the register 
@@ -236,6 +457,9 @@ classdef mtca4u < mtca4u_interface
         %    [data] = board.read_raw(module, register)
         %    [data] = board.read_raw(module, register, offset)
         %    [data] = board.read_raw(module, register, offset, elements)
+        %    [data] = board.read_raw(module, register, offset, elements, signed, bit, fracbit)
+        %    [data] = board.read_raw(module, register, offset, elements, signed, bit, fracbit, class)
+        %    [data] = board.read_raw(module, register, offset, elements, {'minmax', 100})
         %    ...
         %
         % Inputs:
@@ -243,9 +467,15 @@ classdef mtca4u < mtca4u_interface
         %    register - Name of the register
         %    offset - Start element of the writing (optional, default: 1)
         %    elements - Number of elements to be read (optional, default: 'numel(offset:end)')
+        %    signed - Fixed point interpretation of the raw words is signed (optional)
+        %    bit - Number of bits of the fixed point value (optional, default: 32)
+        %    fracbit - Number of fractional bits (optional, default: 0)
+        %    class - 'double' (default) or 'single' for the converted values (optional)
+        %    reduction - Returns only reduced data, see mtca4u.read (optional)
         %
         % Outputs:
-        %    data - raw value/s from the register without fixedpoint conversion.
+        %    data - raw value/s from the register without fixedpoint conversion as int32,
+        %           or the values converted with the given fixed point format.
         %
         % See also: mtca4u, mtca4u.read, mtca4u.write
             try
@@ -282,6 +512,57 @@ classdef mtca4u < mtca4u_interface
             end
         end
 
+        function write_raw(obj, varargin)
+        %mtca4u.write_raw - Writes raw data to the register of a board, optionally
+        %                   converted to a fixed point format.
+        %
+        % Syntax:
+        %    % board = mtca4u('board');
+        %    board.write_raw(module, register, value)
+        %    board.write_raw(module, register, value, offset)
+        %    board.write_raw(module, register, value, offset, signed, bit, fracbit)
+        %
+        % Inputs:
+        %    module - Name of the board
+        %    register - Name of the register
+        %    value - Value or Vector to be written
+        %    offset - Start element of the writing (optional, default: 0)
+        %    signed - Fixed point format is signed (optional, default: raw int32 words)
+        %    bit - Number of bits of the fixed point value (optional, default: 32)
+        %    fracbit - Number of fractional bits (optional, default: 0)
+        %
+        % See also: mtca4u, mtca4u.read_raw, mtca4u.write
+            try
+                mtca4u_mex('write_raw', obj.handle, varargin{:});
+            catch ex
+                error(ex.message);
+            end
+        end
+
+        function report = write_many(obj, specs, varargin)
+        %mtca4u.write_many - Writes several registers in one transfer group
+        %
+        % Syntax:
+        %    % board = mtca4u('board');
+        %    board.write_many({{module, register, value}, {module, register, value, offset}, ...})
+        %    [report] = board.write_many(specs, verify)
+        %
+        % Inputs:
+        %    specs - Cell array of {module, register, value, [offset]} cells
+        %    verify - Read all registers back and compare them (optional, default: false)
+        %
+        % Outputs:
+        %    report - Struct array with the fields register, mismatches, indices
+        %             and readback per register, empty if verify is not set
+        %
+        % See also: mtca4u, mtca4u.write, mtca4u.read_many
+            try
+                report = mtca4u_mex('write_many', obj.handle, specs, varargin{:});
+            catch ex
+                error(ex.message);
+            end
+        end
+
         function [varargout] = read_dma_raw(obj, varargin)
         %mtca4u.read_dma_raw - Reads data from a board using direct memory access
         %
@@ -299,9 +580,9 @@ classdef mtca4u < mtca4u_interface
         %    offset - Start element of the writing (optional, default: 1)
         %    elements - Number of elements to be read (optional, default: 'numel(offset:end)')
         %    mode - Data mode of 16 or 32bit (optional, default: 32)
-        %    singed - Data mode of 16 or 32bit (optional, default: false)
-        %    bit - Data mode of 16 or 32bit (optional, default: mode)
-        %    fracbit - Data mode of 16 or 32bit (optional, default: 0)
+        %    singed - Fixed point interpretation of the raw words is signed (optional, default: no conversion)
+        %    bit - Number of bits of the fixed point value (optional, default: mode)
+        %    fracbit - Number of fractional bits (optional, default: 0)
         %
         % Outputs:
         %    data - Value/s of the DAQ Block
@@ -358,6 +639,8 @@ classdef mtca4u < mtca4u_interface
         %    [data] = board.read_seq(module, register, sequence)
         %    [data] = board.read_seq(module, register, sequence, offset, elements)
         %    [sequence1, sequence2, ...] = mtca4u.read_seq(module, register, [1, 2 ...], offset, elements)
+        %    [data] = board.read_seq(module, register, sequence, offset, elements, class)
+        %    [data] = board.read_seq(module, register, sequence, offset, elements, {'mean', 1000})
         %    ...
         %
         % Inputs:
@@ -366,6 +649,9 @@ classdef mtca4u < mtca4u_interface
         %    sequence - Number of the sequence
         %    offset - Offset into the sequence
         %    elements - Number of samples to read (optional, default: all available)
+        %    class - Class of the output, see mtca4u.read (optional, default: 'double')
+        %    reduction - Reduces each sequence, see mtca4u.read (optional). 'minmax' returns
+        %                a bins x sequences x 2 array with the minima and maxima.
         %
         % Outputs:
         %    data - Values of the sequence(s)
@@ -377,6 +663,297 @@ classdef mtca4u < mtca4u_interface
             error(ex.message);
           end
         end
+
+        function [data, received, version] = read_wait(obj, varargin)
+        %mtca4u.read_wait - Reads a register when its next update has been pushed
+        %
+        % Syntax:
+        %    % board = mtca4u('board');
+        %    [data, received, version] = board.read_wait(module, register)
+        %    [data, received, version] = board.read_wait(module, register, timeout)
+        %    [data, received, version] = board.read_wait(module, register, timeout, mode)
+        %
+        % Inputs:
+        %    module - Name of the module
+        %    register - Name of the register, it has to support wait_for_new_data
+        %    timeout - Maximum time to wait in seconds, finite (optional, default: 10)
+        %    mode - 'wait', 'nonblocking' or 'latest' (optional, default: 'wait')
+        %
+        % Outputs:
+        %    data - Value/s of the register
+        %    received - true if new data has been received
+        %    version - Version number of the data as posix time in seconds, equal for the same update
+        %
+        % See also: mtca4u, mtca4u.read
+          try
+            [data, received, version] = mtca4u_mex('read_wait', obj.handle, varargin{:});
+          catch ex
+            error(ex.message);
+          end
+        end
+
+        function data = read_many(obj, specs)
+        %mtca4u.read_many - Reads several registers in one transfer group
+        %
+        % Syntax:
+        %    % board = mtca4u('board');
+        %    [data] = board.read_many({{module, register}, {module, register, offset, elements}, ...})
+        %
+        % Inputs:
+        %    specs - Cell array of {module, register, [offset], [elements]} cells
+        %
+        % Outputs:
+        %    data - Cell array with the values of each register
+        %
+        % See also: mtca4u, mtca4u.read
+          try
+            data = mtca4u_mex('read_many', obj.handle, specs);
+          catch ex
+            error(ex.message);
+          end
+        end
+
+        function [data, latency, polls] = capture(obj, varargin)
+        %mtca4u.capture - Reads several registers as soon as a trigger condition is met
+        %
+        % Syntax:
+        %    % board = mtca4u('board');
+        %    [data, latency, polls] = board.capture(module, register, condition, value, specs)
+        %    [data, latency, polls] = board.capture(module, register, condition, value, specs, timeout, spin, sleep)
+        %
+        % Inputs:
+        %    module - Name of the module of the trigger register
+        %    register - Name of the trigger register
+        %    condition - 'equal', 'changed', 'bitmask' (all bits of value set) or 'threshold' (>= value)
+        %    value - Value to compare the trigger with (ignored for 'changed')
+        %    specs - Cell array of {module, register, [offset], [elements]} cells to capture
+        %    timeout - Maximum time to wait in seconds (optional, default: 10)
+        %    spin - Number of polls without sleeping (optional, default: 1000)
+        %    sleep - Sleep between the polls after that in seconds (optional, default: 1e-4)
+        %
+        % Outputs:
+        %    data - Cell array with the values of each captured register
+        %    latency - Time from the poll meeting the condition until the data was read in seconds
+        %    polls - Number of times the trigger has been read
+        %
+        % See also: mtca4u, mtca4u.read_many
+          try
+            [data, latency, polls] = mtca4u_mex('capture', obj.handle, varargin{:});
+          catch ex
+            error(ex.message);
+          end
+        end
+
+        function h = acq_start(obj, varargin)
+        %mtca4u.acq_start - Starts reading a register continuously in the background
+        %
+        % Syntax:
+        %    % board = mtca4u('board');
+        %    h = board.acq_start(module, register, period)
+        %    h = board.acq_start(module, register, 'push', capacity, offset, elements)
+        %
+        % Inputs:
+        %    module - Name of the module
+        %    register - Name of the register
+        %    period - Read period in seconds, or 'push' to read every new block of
+        %             a register supporting wait_for_new_data
+        %    capacity - Number of blocks buffered between two fetches (optional, default: 1000)
+        %    offset - Start element (optional, default: 0)
+        %    elements - Number of elements (optional, default: all remaining)
+        %
+        % Outputs:
+        %    h - Acquisition handle for acq_fetch and acq_stop
+        %
+        % See also: mtca4u, mtca4u.acq_fetch, mtca4u.acq_stop
+          try
+            h = mtca4u_mex('acq_start', obj.handle, varargin{:});
+          catch ex
+            error(ex.message);
+          end
+        end
+
+        function [data, timestamps, overruns] = acq_fetch(~, h)
+        %mtca4u.acq_fetch - Returns all blocks acquired since the last call
+        %
+        % Syntax:
+        %    [data, timestamps, overruns] = board.acq_fetch(h)
+        %
+        % Outputs:
+        %    data - One column per block
+        %    timestamps - Posix time of each block
+        %    overruns - Number of blocks dropped because the buffer was full
+        %
+        % See also: mtca4u, mtca4u.acq_start, mtca4u.acq_stop
+          try
+            [data, timestamps, overruns] = mtca4u_mex('acq_fetch', h);
+          catch ex
+            error(ex.message);
+          end
+        end
+
+        function acq_stop(~, h)
+        %mtca4u.acq_stop - Stops a background acquisition
+        %
+        % See also: mtca4u, mtca4u.acq_start, mtca4u.acq_fetch
+          try
+            mtca4u_mex('acq_stop', h);
+          catch ex
+            error(ex.message);
+          end
+        end
+
+        function h = record_start(obj, varargin)
+        %mtca4u.record_start - Starts recording registers to a binary file in the background
+        %
+        % Syntax:
+        %    % board = mtca4u('board');
+        %    h = board.record_start({{module, register}, ...}, file, period)
+        %    h = board.record_start({{module, register, offset, elements}, ...}, file, period, class)
+        %
+        % Inputs:
+        %    specs - Cell array of {module, register, [offset], [elements]} cells. 2D registers
+        %            are recorded with all channels, offset and elements apply to each channel.
+        %    file - Name of the file to be written
+        %    period - Read period in seconds
+        %    class - Class the values are stored as, see mtca4u.read (optional, default: 'double')
+        %
+        % Outputs:
+        %    h - Recording handle for record_stop
+        %
+        % See also: mtca4u, mtca4u.record_stop, mtca4u.record_open
+          try
+            h = mtca4u_mex('record_start', obj.handle, varargin{:});
+          catch ex
+            error(ex.message);
+          end
+        end
+
+        function nBlocks = record_stop(~, h)
+        %mtca4u.record_stop - Stops a recording and returns the number of blocks written
+        %
+        % See also: mtca4u, mtca4u.record_start, mtca4u.record_open
+          try
+            nBlocks = mtca4u_mex('record_stop', h);
+          catch ex
+            error(ex.message);
+          end
+        end
+
+        function h = resolve(obj, varargin)
+        %mtca4u.resolve - Resolves a register once and returns a handle for read_h/write_h
+        %
+        % Syntax:
+        %    % board = mtca4u('board');
+        %    h = board.resolve(module, register)
+        %    h = board.resolve(module, register, offset, elements)
+        %    h = board.resolve(module, register, offset, elements, type)
+        %
+        % Inputs:
+        %    module - Name of the module
+        %    register - Name of the register
+        %    offset - Start element (optional, default: 0)
+        %    elements - Number of elements (optional, default: 0 = all remaining)
+        %    type - 'double' or 'raw' (optional, default: 'double')
+        %
+        % Outputs:
+        %    h - Register handle. It stays valid until the device is closed.
+        %
+        % See also: mtca4u, mtca4u.read_h, mtca4u.write_h
+          try
+            h = mtca4u_mex('resolve', obj.handle, varargin{:});
+          catch ex
+            error(ex.message);
+          end
+        end
+
+        function data = read_h(~, h)
+        %mtca4u.read_h - Reads data through a register handle
+        %
+        % Syntax:
+        %    h = board.resolve(module, register);
+        %    [data] = board.read_h(h)
+        %
+        % See also: mtca4u, mtca4u.resolve, mtca4u.write_h
+          try
+            data = mtca4u_mex('read_h', h);
+          catch ex
+            error(ex.message);
+          end
+        end
+
+        function write_h(~, h, value)
+        %mtca4u.write_h - Writes data through a register handle
+        %
+        % Syntax:
+        %    h = board.resolve(module, register);
+        %    board.write_h(h, value)
+        %
+        % Inputs:
+        %    value - Values to be written. The number of elements must match the handle.
+        %
+        % See also: mtca4u, mtca4u.resolve, mtca4u.read_h
+          try
+            mtca4u_mex('write_h', h, value);
+          catch ex
+            error(ex.message);
+          end
+        end
+
+        function t = read_async(obj, varargin)
+        %mtca4u.read_async - Starts a read in the background and returns a ticket
+        %
+        % Syntax:
+        %    % board = mtca4u('board');
+        %    t = board.read_async(command, module, register)
+        %    t = board.read_async(command, module, register, offset, elements)
+        %
+        % Inputs:
+        %    command - 'read', 'read_raw' (int32 raw words) or 'read_seq' (elements x channels)
+        %    module - Name of the module
+        %    register - Name of the register
+        %    offset - Index of the first element (per channel for 'read_seq', optional, default: 0)
+        %    elements - Number of elements (per channel for 'read_seq', optional, default: all remaining)
+        %
+        % Outputs:
+        %    t - Ticket for read_ready and read_fetch
+        %
+        % See also: mtca4u, mtca4u.read_ready, mtca4u.read_fetch
+          try
+            t = mtca4u_mex('read_async', varargin{1}, obj.handle, varargin{2:end});
+          catch ex
+            error(ex.message);
+          end
+        end
+
+        function ready = read_ready(~, t)
+        %mtca4u.read_ready - Checks if the read of a ticket has finished
+        %
+        % Syntax:
+        %    ready = board.read_ready(t)
+        %
+        % See also: mtca4u, mtca4u.read_async, mtca4u.read_fetch
+          try
+            ready = mtca4u_mex('read_ready', t);
+          catch ex
+            error(ex.message);
+          end
+        end
+
+        function data = read_fetch(~, t)
+        %mtca4u.read_fetch - Waits for the read of a ticket and returns the data
+        %
+        % Syntax:
+        %    data = board.read_fetch(t)
+        %
+        % The ticket is released and cannot be fetched again.
+        %
+        % See also: mtca4u, mtca4u.read_async, mtca4u.read_ready
+          try
+            data = mtca4u_mex('read_fetch', t);
+          catch ex
+            error(ex.message);
+          end
+        end
     end
 end
 
@@ -3,12 +3,22 @@ classdef mtca4u_remote < mtca4u_interface
   %
   % Syntax:
   %    m = mtca4u_remote(board, path, host, user)
+  %    m = mtca4u_remote(board, address, [timeout])
   %
   % Inputs:
   %    board - Name of the board
   %    path - Remote Working Directory
   %    host - Address of the remote machine
   %    user - Remote User name
+  %    address - Address of a running mtca4u_server, tcp://host:port or unix:///path.
+  %              The connection stays open, so a request costs one round trip
+  %              instead of one ssh session. shm://name connects to a broker
+  %              (mtca4u_server shm://name) on the same host, which shares the
+  %              devices between all Matlab sessions.
+  %    timeout - Seconds without an answer of the server until a request
+  %              fails and the connection is dropped (default 5)
+  %              A broker (shm://name) serves the sessions one after the
+  %              other, its connections are only dropped if it is gone.
   %   
   % mtca4u Methods:
   %    print_info - Displays all available boards with additional information
@@ -18,6 +28,8 @@ classdef mtca4u_remote < mtca4u_interface
   %    write - Writes data to the register of a board
   %    read_dma_raw - Reads raw data from a board using direct memory access
   %    read_dma - Reads channel data from a board using direct memory access
+  %    pipeline - Sends several requests to an mtca4u_server in one round trip
+  %    read_shared - Reads data, reusing a recent read of another session of the broker
   %
   
   % Autor:
@@ -35,6 +47,8 @@ classdef mtca4u_remote < mtca4u_interface
 		board = [];
         channel = 0;
         c;
+        connection = 0; % Connection handle of the mtca4u_server, 0 if ssh is used
+        device = 0;     % Device handle on the mtca4u_server
         required_tools_version = '00.14';
         %remote_executable = strcat('mtca4u-', self.required_tools_version);
         remote_executable = 'mtca4u-00.14';
@@ -43,12 +57,25 @@ classdef mtca4u_remote < mtca4u_interface
     methods (Access = 'private')
         %mtca4u.delete - Destructor of the Wrapper class
         function delete(obj)
+            if obj.connection ~= 0
+              mtca4u_mex('remote_disconnect', obj.connection);
+              obj.connection = 0;
+            end
             if obj.channel ~= 0
               obj.channel.close();
               disp('Connection closed...')
             end
         end
         
+        function result = request(obj, command, varargin)
+            try
+              result = mtca4u_mex('remote_request', obj.connection, {[{command, obj.device}, varargin]});
+              result = result{1};
+            catch ex
+              error(ex.message);
+            end
+        end
+
         function res = ReadStdout(~, channel)
             res = [];
             stdout = ch.ethz.ssh2.StreamGobbler(channel.getStdout());
@@ -109,6 +136,8 @@ classdef mtca4u_remote < mtca4u_interface
         %    path - Remote Working Directory
         %    host - Address of the remote machine
         %    user - Remote User name
+        %    address - Address of a running mtca4u_server (tcp://host:port, unix:///path or shm://name)
+        %    timeout - Seconds without an answer of the server until a request fails (default 5)
         %
         function obj = mtca4u_remote(board, path, hostName, userName, id_file)
             if(nargout ~= 1)
@@ -116,6 +145,25 @@ classdef mtca4u_remote < mtca4u_interface
             end
 			if isempty(board)
                 error('Invalid board name.');
+            end
+            % Use the binary protocol if the second argument is a server address
+            if (nargin == 2 || nargin == 3) && (strncmp(path, 'tcp://', 6) || strncmp(path, 'unix://', 7) || strncmp(path, 'shm://', 6))
+                try
+                  if nargin == 3
+                    obj.connection = mtca4u_mex('remote_connect', path, hostName);
+                  else
+                    obj.connection = mtca4u_mex('remote_connect', path);
+                  end
+                  result = mtca4u_mex('remote_request', obj.connection, {{'open', board}});
+                catch ex
+                  if obj.connection ~= 0, mtca4u_mex('remote_disconnect', obj.connection); end
+                  error(ex.message);
+                end
+                obj.c = onCleanup(@()delete(obj));
+                obj.device = result{1};
+                obj.board = board;
+                obj.path = path;
+                return
             end
 			if isempty(path)
                 error('Invalid path.');
@@ -171,6 +219,11 @@ classdef mtca4u_remote < mtca4u_interface
         function result = version(obj,~)
         %mtca4u_remote.version - Shows the version of the remote tools
         %
+          if obj.connection ~= 0
+            result = mtca4u_mex('remote_request', obj.connection, {{'version'}});
+            result = result{1};
+            return
+          end
           cmd = ['cd ''', obj.path, ''' && ''', obj.remote_executable ,''' version'];
           if obj.debug, disp(['Run: ', cmd]); end
           channel2 = obj.channel.openSession();
@@ -213,6 +266,10 @@ classdef mtca4u_remote < mtca4u_interface
         %    module - Name of the module
         %    register - Name of the register
         %
+          if obj.connection ~= 0
+            result = request(obj, 'register_size', varargin{:});
+            return
+          end
           cmd = ['cd ''', obj.path, ''' && ''', obj.remote_executable ,''' register_size ', obj.board, ' ', createCLTString(obj, varargin)];
           if obj.debug, disp(['Run: ', cmd]); end
           channel2 = obj.channel.openSession();
@@ -248,6 +305,10 @@ classdef mtca4u_remote < mtca4u_interface
         %
         %
         % See also: mtca4u , mtca4u.write
+          if obj.connection ~= 0
+            result = request(obj, 'read', varargin{:});
+            return
+          end
           cmd = ['cd ''', obj.path, ''' && ''', obj.remote_executable ,''' read ', obj.board, ' ', createCLTString(obj, varargin)];
           if obj.debug, disp(['Run: ', cmd]); end
           channel2 = obj.channel.openSession();
@@ -277,6 +338,10 @@ classdef mtca4u_remote < mtca4u_interface
         %    offset - Start element of the writing (optional, default: 0)
         %
         % See also: mtca4u, mtca4u.read
+            if obj.connection ~= 0
+                result = request(obj, 'write', varargin{:});
+                return
+            end
             cmd = ['cd ''', obj.path, ''' && ''', obj.remote_executable ,''' write ', obj.board, ' ', createCLTString(obj, varargin)];
             if obj.debug, disp(['Run: ', cmd]); end
             channel2 = obj.channel.openSession();
@@ -354,6 +419,18 @@ classdef mtca4u_remote < mtca4u_interface
         %    data - Values of the sequence(s)
         %
         % See also: mtca4u, mtca4u.read, mtca4u.write
+          if obj.connection ~= 0
+            % The server returns all sequences, the selection is done here
+            result = request(obj, 'read_seq', varargin{1:min(2, end)});
+            if nargin > 3 && ~isempty(varargin{3}), result = result(:, varargin{3}); end
+            first = 1;
+            if nargin > 4 && ~isempty(varargin{4}), first = varargin{4} + 1; end
+            last = size(result, 1);
+            if nargin > 5 && ~isempty(varargin{5}), last = first + varargin{5} - 1; end
+            if last > size(result, 1), error('Offset and elements exceed the sequence length.'); end
+            result = result(first:last, :);
+            return
+          end
           cmd = ['cd ''', obj.path, ''' && ''', obj.remote_executable ,''' read_seq ', obj.board, ' ', createCLTString(obj, varargin)];
           if obj.debug, disp(['Run: ', cmd]); end
           channel2  =  obj.channel.openSession();
@@ -367,6 +444,62 @@ classdef mtca4u_remote < mtca4u_interface
           channel2.close();
         end
         
+    
+        function result = read_shared(obj, varargin)
+        %mtca4u_remote.read_shared - Reads data, reusing a recent read of another session
+        %
+        % Syntax:
+        %    % board = mtca4u_remote('board', 'shm://name');
+        %    [data] = board.read_shared(module, register, max_age)
+        %    [data] = board.read_shared(module, register, max_age, offset, elements)
+        %
+        % Inputs:
+        %    module - Name of the module (if none use: '')
+        %    register - Name of the register
+        %    max_age - Maximum age in seconds of data read by another session of the broker
+        %    offset - Start element of the reading (optional, default: 0)
+        %    elements - Number of elements to be read (optional, default: 'offset:end')
+        %
+        % Outputs:
+        %    data - Value/s of the register
+        %
+        % Without a broker (tcp or unix socket) the data is always read.
+        %
+        % See also: mtca4u_remote.read
+          if obj.connection == 0
+            error('read_shared requires a connection to an mtca4u_server.');
+          end
+          result = request(obj, 'read_shared', varargin{:});
+        end
+
+        function result = pipeline(obj, requests)
+        %mtca4u_remote.pipeline - Sends several requests to the mtca4u_server in one round trip
+        %
+        % Syntax:
+        %    % board = mtca4u_remote('board', 'tcp://host:port');
+        %    [results] = board.pipeline({{'read', module, register}, {'write', module, register, value}, ...})
+        %
+        % Inputs:
+        %    requests - Cell array of requests {command, module, register, ...} with the arguments
+        %               of the read, write, read_raw, read_seq, read_shared and register_size methods
+        %
+        % Outputs:
+        %    results - Cell array with the result of each request
+        %
+        % See also: mtca4u_remote.read, mtca4u_remote.write
+          if obj.connection == 0
+            error('Pipelining requires a connection to an mtca4u_server.');
+          end
+          for i = 1:numel(requests)
+            requests{i} = [requests{i}(1), {obj.device}, requests{i}(2:end)];
+          end
+          try
+            result = mtca4u_mex('remote_request', obj.connection, requests);
+          catch ex
+            error(ex.message);
+          end
+        end
+
     end
 end
 
@@ -11,27 +11,55 @@
  *
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <regex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
 #include <vector>
 
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <ChimeraTK/BackendFactory.h>
 #include <ChimeraTK/Device.h>
+#include <ChimeraTK/NumericAddressedRegisterCatalogue.h>
 #include <ChimeraTK/RegisterPath.h>
+#include <ChimeraTK/TransferGroup.h>
 #include <ChimeraTK/Utilities.h>
 #include <ChimeraTK/DMapFileParser.h>
 #include <mex.h>
 
 #include "../include/version.h"
+#include "mtca4u_protocol.h"
+#include "mtca4u_shm.h"
 
 using namespace ChimeraTK;
 using namespace std;
 
-template<typename UserType>
-void writeToDevice(boost::shared_ptr<Device>& device, const std::string& registerPath, void* data, size_t numberOfwords,
-    size_t Offset);
+template<typename SourceType, typename UserType = SourceType>
+void writeToDevice(Device& device, const RegisterPath& registerPath, const mxArray* value, size_t offset);
+
+typedef void (*WriteFnc)(Device&, const RegisterPath&, const mxArray*, size_t);
+WriteFnc getWriteFunction(mxClassID classID);
 
 // Some c++ wrapper and utility functions
 
@@ -87,731 +115,4787 @@ boost::shared_ptr<Device> getDevice(const mxArray* plhsDevice);
 // Global Parameter
 
 bool isInit = false; // Used to initalize stuff at the first run
-std::vector<boost::shared_ptr<Device>> openDevicesVector;
 
-// Command Function declarations and stuff
+// Device handles
 
-typedef void (*CmdFnc)(unsigned int, mxArray**, unsigned int, const mxArray**);
+// dmap file and alias a device has been opened with
+typedef std::pair<std::string, std::string> DeviceName;
 
-struct Command {
-  string Name;
-  CmdFnc pCallback;
-  string Description;
-  string Example;
-  Command(string n, CmdFnc p, string d, string e) : Name(n), pCallback(p), Description(d), Example(e){};
+/**
+ * @brief Slot of the device handle table
+ *
+ * The handle is slot + generation * maxDeviceSlots. The generation is
+ * incremented when the slot is freed, so a stale handle is detected even if
+ * the slot has been reused.
+ */
+struct DeviceSlot {
+  boost::shared_ptr<Device> device; // NULL if the slot is free
+  size_t generation{0};
+  DeviceName name;
+  std::shared_ptr<std::mutex> transferMutex; // see SharedDevice
 };
 
-void PrintHelp(unsigned int, mxArray**, unsigned int, const mxArray**);
-void getVersion(unsigned int, mxArray**, unsigned int, const mxArray**);
-void openDevice(unsigned int, mxArray**, unsigned int, const mxArray**);
-void closeDevice(unsigned int, mxArray**, unsigned int, const mxArray**);
-void getInfo(unsigned int, mxArray**, unsigned int, const mxArray**);
-void getDeviceInfo(unsigned int, mxArray**, unsigned int, const mxArray**);
-void getRegisterInfo(unsigned int, mxArray**, unsigned int, const mxArray**);
-void getRegisterSize(unsigned int, mxArray**, unsigned int, const mxArray**);
-void readRegister(unsigned int, mxArray**, unsigned int, const mxArray**);
-void writeRegister(unsigned int, mxArray**, unsigned int, const mxArray**);
-void readDmaRaw(unsigned int, mxArray**, unsigned int, const mxArray**);
-void readSequence(unsigned int, mxArray**, unsigned int, const mxArray**);
-void setDMapFilePath(unsigned int, mxArray**, unsigned int, const mxArray**);
-void getDMapFilePath(unsigned int, mxArray**, unsigned int, const mxArray**);
-void readRaw(unsigned int, mxArray**, unsigned int, const mxArray**);
+/**
+ * @brief An opened device shared by all handles with the same alias and dmap file
+ */
+struct SharedDevice {
+  boost::shared_ptr<Device> device;
+  size_t references{0};
+  // Serialises all use of the device, as a backend may not be used from several threads at once. The Matlab
+  // thread holds it while a command uses the device (see CommandDeviceLock), the native threads around each transfer.
+  std::shared_ptr<std::mutex> transferMutex{std::make_shared<std::mutex>()};
+};
 
-vector<Command> vectorOfCommands = {Command("help", &PrintHelp, "", ""), Command("version", &getVersion, "", ""),
-    Command("nop", NULL, "", ""), Command("open", &openDevice, "", ""), Command("close", &closeDevice, "", ""),
-    Command("info", &getInfo, "", ""), Command("device_info", &getDeviceInfo, "", ""),
-    Command("register_info", &getRegisterInfo, "", ""), Command("register_size", &getRegisterSize, "", ""),
-    Command("read", &readRegister, "", ""), Command("write", &writeRegister, "", ""),
-    Command("read_dma_raw", &readDmaRaw, "", ""), Command("read_seq", &readSequence, "", ""),
-    Command("set_dmap", &setDMapFilePath, "", ""), Command("get_dmap", &getDMapFilePath, "", ""),
-    Command("read_raw", &readRaw, "", "")};
+const size_t maxDeviceSlots = 1 << 16;
+
+std::vector<DeviceSlot> deviceSlotsVector;
+std::vector<size_t> freeDeviceSlots;
+std::map<DeviceName, SharedDevice> sharedDevicesMap;
+
+DeviceSlot* findDeviceSlot(size_t deviceHandle);
 
 /**
- * @brief Mex Entry Function
- *
- * @param[in] nlhs Number of left hand side parameter
- * @param[inout] phls Pointer to the left hand side parameter
- * @param[in] rhhs Numer of the right hand side parameter
- * @param[inout] prhs Pointer to the right hand side parameter
+ * @brief Transfer mutex of the device used by the running command
  *
+ * It is taken by getDevice and released when the command returns, so the
+ * native threads only use the device between the commands.
  */
-void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]) {
-  // Initalize basic stuff
-  if(isInit == false) {
-    // Setting devices.dmap as default is just for convenience. Some scripts
-    // might rely on it.
-    // DeviceAccess from 01.00 is throwing if the file is not there.
-    // We just catch the exception and continue. The user will set his own
-    // dmap file later if needed.
-    try {
-      ChimeraTK::setDMapFilePath("./devices.dmap");
-    }
-    catch(ChimeraTK::logic_error&) {
-    }
-
-    isInit = true;
+class CommandDeviceLock {
+ public:
+  void lock(const std::shared_ptr<std::mutex>& mutex_) {
+    if(mutex == mutex_) return;
+    release();
+    lock_ = std::unique_lock<std::mutex>(*mutex_);
+    mutex = mutex_;
   }
 
-  if(nrhs == 0) {
-    mexErrMsgTxt("Not enough input arguments.");
-    return;
-  }
-  if(!mxIsChar(prhs[0])) {
-    mexErrMsgTxt("Invalid input arguments.");
-    return;
+  void release() {
+    if(lock_.owns_lock()) lock_.unlock();
+    mutex.reset();
   }
 
-  string cmd = mxArrayToStdString(prhs[0]);
-  transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
+ private:
+  std::shared_ptr<std::mutex> mutex; // keeps the mutex alive if the device is closed meanwhile
+  std::unique_lock<std::mutex> lock_;
+};
 
-  try {
-    vector<Command>::iterator it = vectorOfCommands.begin();
+CommandDeviceLock commandDeviceLock;
+size_t readChunkSize = 0; // Maximum number of elements per transfer in read and read_raw, 0 = no limit
 
-    // Look for the right command
-    for(; it != vectorOfCommands.end(); ++it) {
-      if(it->Name == cmd) break;
-    }
+/**
+ * @brief Accessors of the windows of a register read in chunks, see readToMxArray
+ *
+ * Only the register read last in chunks is kept, so repeated chunked reads
+ * of it skip the accessor setup, while the cached buffers never exceed the
+ * size of one register.
+ */
+struct ChunkAccessors {
+  virtual ~ChunkAccessors() = default;
+};
 
-    // Check if search was successful
-    if(it == vectorOfCommands.end()) {
-      mexErrMsgTxt("Unknown command '" + cmd + "'. Use mtca4u('help') to show some help information.");
-      return;
-    }
+template<typename UserType>
+struct ChunkAccessorsImpl : ChunkAccessors {
+  std::vector<OneDRegisterAccessor<UserType>> accessors;
+};
 
-    // Check if the method is implemented
-    else if(NULL == it->pCallback) {
-      mexErrMsgTxt("Command not implemented yet.");
-      return;
-    }
+// Key: device, register path, offset, requested elements, chunk size, raw
+typedef std::tuple<const Device*, std::string, uint32_t, uint32_t, size_t, bool> ChunkAccessorsKey;
 
-    // Ok run method
-    else
-      it->pCallback(nlhs, plhs, nrhs - 1, &prhs[1]);
-  }
+ChunkAccessorsKey chunkAccessorsKey;
+std::unique_ptr<ChunkAccessors> chunkAccessors;
 
-  catch(ChimeraTK::runtime_error& e) {
-    mexErrMsgTxt(e.what());
-  }
-  catch(ChimeraTK::logic_error& e) {
-    mexErrMsgTxt(e.what());
-  }
-}
+// Register handles
 
-void getDMapFilePath(unsigned int, mxArray* plhs[], unsigned int, const mxArray**) {
-  plhs[0] = mxCreateString((BackendFactory::getInstance().getDMapFilePath()).c_str());
+/**
+ * @brief Matlab class matching the given UserType
+ */
+template<typename UserType>
+mxClassID getMxClassID();
+template<>
+mxClassID getMxClassID<double>() {
+  return mxDOUBLE_CLASS;
+}
+template<>
+mxClassID getMxClassID<float>() {
+  return mxSINGLE_CLASS;
+}
+template<>
+mxClassID getMxClassID<int8_t>() {
+  return mxINT8_CLASS;
+}
+template<>
+mxClassID getMxClassID<uint8_t>() {
+  return mxUINT8_CLASS;
+}
+template<>
+mxClassID getMxClassID<int16_t>() {
+  return mxINT16_CLASS;
+}
+template<>
+mxClassID getMxClassID<uint16_t>() {
+  return mxUINT16_CLASS;
+}
+template<>
+mxClassID getMxClassID<int32_t>() {
+  return mxINT32_CLASS;
+}
+template<>
+mxClassID getMxClassID<uint32_t>() {
+  return mxUINT32_CLASS;
+}
+template<>
+mxClassID getMxClassID<int64_t>() {
+  return mxINT64_CLASS;
+}
+template<>
+mxClassID getMxClassID<uint64_t>() {
+  return mxUINT64_CLASS;
 }
 
 /**
- * @brief setDMapFilePath
+ * @brief Calls fn with a default constructed value of the UserType matching the Matlab class
  *
+ * Use with a generic lambda: callForMxClass(classID, [&](auto v) { typedef decltype(v) UserType; ... });
  */
-void setDMapFilePath(unsigned int, mxArray**, unsigned int nrhs, const mxArray* prhs[]) {
-  if(nrhs < 1) mexErrMsgTxt("Not enough input params.");
-  if(nrhs > 1) mexWarnMsgTxt("Too many input arguments.");
-  std::string dMapFile = mxArrayToStdString(prhs[0]);
-  ChimeraTK::setDMapFilePath(dMapFile);
+template<typename Function>
+void callForMxClass(mxClassID classID, Function fn) {
+  switch(classID) {
+    case mxDOUBLE_CLASS:
+      fn(double());
+      break;
+    case mxSINGLE_CLASS:
+      fn(float());
+      break;
+    case mxINT8_CLASS:
+      fn(int8_t());
+      break;
+    case mxUINT8_CLASS:
+      fn(uint8_t());
+      break;
+    case mxINT16_CLASS:
+      fn(int16_t());
+      break;
+    case mxUINT16_CLASS:
+      fn(uint16_t());
+      break;
+    case mxINT32_CLASS:
+      fn(int32_t());
+      break;
+    case mxUINT32_CLASS:
+      fn(uint32_t());
+      break;
+    case mxINT64_CLASS:
+      fn(int64_t());
+      break;
+    case mxUINT64_CLASS:
+      fn(uint64_t());
+      break;
+    default:
+      mexErrMsgTxt("Data type unsupported.");
+  }
 }
 
 /**
- * @brief getDevice
- *
- * @param[in] dmapFileName File to be loaded or all in the current directory if
- * empty
+ * @brief Copies the content of a numeric or logical Matlab array into a buffer of UserType
  *
+ * The values are converted with a plain C++ cast in one bulk pass. If the
+ * classes match this is a memcpy.
  */
-boost::shared_ptr<Device> getDevice(const mxArray* prhsDevice) {
-  if(!mxIsRealScalar(prhsDevice)) mexErrMsgTxt("Invalid device handle.");
-
-  const size_t deviceHandle = mxGetScalar(prhsDevice);
-
-  if(deviceHandle >= openDevicesVector.size()) mexErrMsgTxt("Invalid device handle.");
-
-  if(!openDevicesVector[deviceHandle]) mexErrMsgTxt("Device closed.");
+template<typename UserType>
+void copyFromMxArray(const mxArray* source, UserType* destination, size_t nElements) {
+  if(mxIsLogical(source)) {
+    std::copy_n(mxGetLogicals(source), nElements, destination);
+    return;
+  }
+  callForMxClass(mxGetClassID(source), [&](auto v) {
+    typedef decltype(v) SourceType;
+    std::copy_n(static_cast<const SourceType*>(mxGetData(source)), nElements, destination);
+  });
+}
 
-  return openDevicesVector[deviceHandle];
+/**
+ * @brief Integer class of the given bit width
+ */
+mxClassID getIntegerMxClassID(size_t nBits, bool isSigned) {
+  if(nBits <= 8) return isSigned ? mxINT8_CLASS : mxUINT8_CLASS;
+  if(nBits <= 16) return isSigned ? mxINT16_CLASS : mxUINT16_CLASS;
+  if(nBits <= 32) return isSigned ? mxINT32_CLASS : mxUINT32_CLASS;
+  return isSigned ? mxINT64_CLASS : mxUINT64_CLASS;
 }
 
 /**
- * @brief PrintHelp shows the help text on the console
+ * @brief Smallest Matlab class which holds all values of the register
  *
+ * Integral registers of numerically addressed backends get the integer class
+ * of their bit width. For other backends the width is estimated from the
+ * digits of the DataDescriptor. Everything else is read as double.
  */
-void PrintHelp(unsigned int, mxArray**, unsigned int, const mxArray**) {
-  mexPrintf(std::string("mtca4u Matlab library revision: ") + gVersion + "\n");
-  mexPrintf("Available Commands are: \n");
+mxClassID getNativeMxClassID(const RegisterInfo& registerInfo) {
+  const DataDescriptor& dataDescriptor = registerInfo.getDataDescriptor();
+  if(dataDescriptor.fundamentalType() != DataDescriptor::FundamentalType::numeric || !dataDescriptor.isIntegral()) {
+    return mxDOUBLE_CLASS;
+  }
 
-  for(vector<Command>::iterator it = vectorOfCommands.begin(); it != vectorOfCommands.end(); ++it) {
-    mexPrintf("\t" + it->Name + "\n");
+  auto numericInfo = dynamic_cast<const NumericAddressedRegisterInfo*>(&registerInfo.getImpl());
+  if(numericInfo && !numericInfo->channels.empty()) {
+    size_t nBits = 0;
+    bool isSigned = false;
+    for(auto& channel : numericInfo->channels) {
+      nBits = std::max<size_t>(nBits, channel.width);
+      isSigned |= channel.signedFlag;
+    }
+    return getIntegerMxClassID(nBits, isSigned);
   }
-  mexPrintf("\n\nFor further help or bug reports please contact "
-            "chimeratk-support@desy.de\n");
+
+  // nDigits is ceil(log10(2^nBits)) plus one for the sign, which only bounds
+  // the width: 3 digits are 7 to 9 bit, so they need 16 bit. 10 digits are 30
+  // to 33 bit and taken as the common 32 bit word.
+  const size_t nDigits = dataDescriptor.nDigits() - (dataDescriptor.isSigned() ? 1 : 0);
+  const size_t nBits = (nDigits <= 2) ? 8 : (nDigits <= 4) ? 16 : (nDigits <= 10) ? 32 : 64;
+  return getIntegerMxClassID(nBits, dataDescriptor.isSigned());
 }
 
 /**
- * @brief Returns the version as a number
- *
+ * @brief Names of the numeric Matlab classes supported as output class
  */
-void getVersion(unsigned int, mxArray* plhs[], unsigned int, const mxArray**) {
-  plhs[0] = mxCreateString(gVersion.c_str());
+const std::map<std::string, mxClassID>& getMxClassNames() {
+  static const std::map<std::string, mxClassID> classNames = {{"double", mxDOUBLE_CLASS}, {"single", mxSINGLE_CLASS},
+      {"int8", mxINT8_CLASS}, {"uint8", mxUINT8_CLASS}, {"int16", mxINT16_CLASS}, {"uint16", mxUINT16_CLASS},
+      {"int32", mxINT32_CLASS}, {"uint32", mxUINT32_CLASS}, {"int64", mxINT64_CLASS}, {"uint64", mxUINT64_CLASS}};
+  return classNames;
 }
 
 /**
- * @brief Force to open the device
+ * @brief Parses the name of an output class argument
  *
+ * 'native' is resolved with the register info from the catalogue.
  */
-void openDevice(unsigned int, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
-  if(nrhs < 1) mexErrMsgTxt("Not enough input arguments.");
-  if(nrhs > 1) mexWarnMsgTxt("Too many input arguments.");
-
-  std::string deviceName = mxArrayToStdString(prhs[0]);
+mxClassID getOutputMxClassID(const mxArray* prhsClass, const Device& device, const RegisterPath& registerPath) {
+  const std::string className = mxArrayToStdString(prhsClass);
+  if(className == "native") {
+    return getNativeMxClassID(device.getRegisterCatalogue().getRegister(registerPath));
+  }
+  auto it = getMxClassNames().find(className);
+  if(it == getMxClassNames().end()) mexErrMsgTxt("Unknown output class '" + className + "'.");
+  return it->second;
+}
 
-  openDevicesVector.push_back(boost::shared_ptr<Device>(new Device()));
-  openDevicesVector.back()->open(deviceName);
+// Fixed point conversion
 
-  plhs[0] = mxCreateDoubleMatrix(1, 1, mxREAL);
-  (*mxGetPr(plhs[0])) = openDevicesVector.size() - 1;
+/**
+ * @brief Fixed point interpretation of the lowest bits of a raw register word
+ */
+struct FixedPointFormat {
+  bool isSigned;
+  unsigned int bits;
+  int fracBits;
+};
 
-#ifdef __MEX_DEBUG_MODE
-  mexPrintf("Successfully opened " + deviceName + "\n");
-#endif
+/**
+ * @brief Parses the optional [signed], [bit], [fracbit] input arguments starting at ppSigned
+ *
+ * bit defaults to maxBits and fracbit to 0.
+ */
+FixedPointFormat parseFixedPointFormat(unsigned int nrhs, const mxArray* prhs[], unsigned int ppSigned, unsigned int maxBits) {
+  const unsigned int ppBits = ppSigned + 1, ppFracBits = ppSigned + 2;
+
+  if(!mxIsRealScalar(prhs[ppSigned]) && !(mxIsLogical(prhs[ppSigned]) && (mxGetNumberOfElements(prhs[ppSigned]) == 1)))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(ppSigned) + " input argument.");
+  if((nrhs > ppBits) && (!mxIsPositiveRealScalar(prhs[ppBits]) || (mxGetScalar(prhs[ppBits]) > maxBits) ||
+                            (mxGetScalar(prhs[ppBits]) != std::floor(mxGetScalar(prhs[ppBits])))))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(ppBits) + " input argument.");
+  if((nrhs > ppFracBits) && (!mxIsRealScalar(prhs[ppFracBits]) ||
+                                (std::fabs(mxGetScalar(prhs[ppFracBits])) > 1000) ||
+                                (mxGetScalar(prhs[ppFracBits]) != std::floor(mxGetScalar(prhs[ppFracBits])))))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(ppFracBits) + " input argument.");
+
+  FixedPointFormat format;
+  format.isSigned = mxGetScalar(prhs[ppSigned]) != 0;
+  format.bits = (nrhs > ppBits) ? mxGetScalar(prhs[ppBits]) : maxBits;
+  format.fracBits = (nrhs > ppFracBits) ? mxGetScalar(prhs[ppFracBits]) : 0;
+  return format;
 }
 
 /**
- * @brief Closes a open device
+ * @brief Converts raw words into fixed point values in one pass
  *
+ * The lowest bits of each word are taken, sign extended if the format is
+ * signed and scaled by 2^-fracBits.
  */
-void closeDevice(unsigned int, mxArray**, unsigned int nrhs, const mxArray* prhs[]) {
-  if(nrhs < 1) mexErrMsgTxt("Not enough input arguments.");
-  if(nrhs > 1) mexWarnMsgTxt("Too many input arguments.");
+template<typename RawType, typename UserType>
+void rawToFixedPoint(const RawType* raw, UserType* destination, size_t nElements, const FixedPointFormat& format) {
+  const uint64_t mask = (uint64_t(1) << format.bits) - 1;
+  const uint64_t signBit = uint64_t(1) << (format.bits - 1);
+  const double scale = std::ldexp(1., -format.fracBits);
+  for(size_t i = 0; i < nElements; ++i) {
+    const uint64_t word = uint64_t(uint32_t(raw[i])) & mask;
+    const int64_t value = (format.isSigned && (word & signBit)) ? int64_t(word) - int64_t(mask) - 1 : int64_t(word);
+    destination[i] = UserType(value * scale);
+  }
+}
 
-  if(!mxIsRealScalar(prhs[0])) mexErrMsgTxt("Invalid device handle.");
+/**
+ * @brief Converts values into raw fixed point words in one pass
+ *
+ * The values are scaled by 2^fracBits, rounded and saturated to the range of
+ * the format. Signed values are stored as two's complement in the lowest bits.
+ */
+template<typename SourceType>
+void fixedPointToRaw(const SourceType* source, int32_t* raw, size_t nElements, const FixedPointFormat& format) {
+  const uint64_t mask = (uint64_t(1) << format.bits) - 1;
+  const double maxValue = format.isSigned ? double(mask >> 1) : double(mask);
+  const double minValue = format.isSigned ? -double(mask >> 1) - 1 : 0.;
+  const double scale = std::ldexp(1., format.fracBits);
+  for(size_t i = 0; i < nElements; ++i) {
+    double value = std::round(double(source[i]) * scale);
+    if(std::isnan(value)) value = 0;
+    value = std::min(std::max(value, minValue), maxValue);
+    raw[i] = int32_t(uint32_t(uint64_t(int64_t(value)) & mask));
+  }
+}
 
-  const size_t deviceHandle = mxGetScalar(prhs[0]);
+// Data reduction in the read path
 
-  if(deviceHandle >= openDevicesVector.size()) mexErrMsgTxt("Invalid device handle.");
+/**
+ * @brief Optional reduction of read, read_raw and read_seq, see parseReduction
+ */
+struct Reduction {
+  enum Kind { none, decimate, mean, rms, minmax, histogram };
+  Kind kind{none};
+  size_t n{0};               // factor, block size or number of bins
+  std::vector<double> edges; // bin edges of the histogram
+};
 
-  // The backend factory will keep a copy, so a rebot backend for instance will
-  // keep the device occupied if we just reset the device object. So we have to
-  // really close it.
-  if(openDevicesVector[deviceHandle]) { // check if device has been
-                                        // closed/deleted already (avoid
-                                        // accessing nullptr)
-    openDevicesVector[deviceHandle]->close();
+/**
+ * @brief Parses a reduction argument
+ *
+ * It is a cell {kind, parameter}:
+ * {'decimate', n} every n-th element (keeps the class of the data),
+ * {'mean', n} and {'rms', n} of blocks of n elements, the last block may be shorter,
+ * {'minmax', n} minimum and maximum of n bins of equal size,
+ * {'histogram', edges} counts of edges(i) <= x < edges(i + 1), the last bin includes its upper edge.
+ */
+Reduction parseReduction(const mxArray* prhsReduction) {
+  static const std::map<std::string, Reduction::Kind> kinds = {{"decimate", Reduction::decimate},
+      {"mean", Reduction::mean}, {"rms", Reduction::rms}, {"minmax", Reduction::minmax},
+      {"histogram", Reduction::histogram}};
+
+  if((mxGetNumberOfElements(prhsReduction) != 2) || !mxGetCell(prhsReduction, 0) ||
+      !mxIsChar(mxGetCell(prhsReduction, 0)) || !mxGetCell(prhsReduction, 1))
+    mexErrMsgTxt("A reduction must be a cell {kind, parameter}.");
+
+  const std::string kindName = mxArrayToStdString(mxGetCell(prhsReduction, 0));
+  auto kind = kinds.find(kindName);
+  if(kind == kinds.end())
+    mexErrMsgTxt("Unknown reduction '" + kindName + "'. Use 'decimate', 'mean', 'rms', 'minmax' or 'histogram'.");
+
+  Reduction reduction;
+  reduction.kind = kind->second;
+  const mxArray* parameter = mxGetCell(prhsReduction, 1);
+  if(reduction.kind == Reduction::histogram) {
+    if(!mxIsRealVector(parameter) || (mxGetNumberOfElements(parameter) < 2))
+      mexErrMsgTxt("The histogram edges must be a vector of at least two values.");
+    reduction.edges.resize(mxGetNumberOfElements(parameter));
+    copyFromMxArray(parameter, reduction.edges.data(), reduction.edges.size());
+    for(size_t i = 1; i < reduction.edges.size(); ++i) {
+      if(!(reduction.edges[i] > reduction.edges[i - 1])) mexErrMsgTxt("The histogram edges must be increasing.");
+    }
   }
-  // Remove the device object. Re-opening will recreate it.
-  openDevicesVector[deviceHandle].reset();
-
-#ifdef __MEX_DEBUG_MODE
-  mexPrintf("Device closed\n");
-#endif
+  else {
+    if(!mxIsPositiveRealScalar(parameter) || (mxGetScalar(parameter) != std::floor(mxGetScalar(parameter))))
+      mexErrMsgTxt("The parameter of the reduction '" + kindName + "' must be a positive integer.");
+    reduction.n = mxGetScalar(parameter);
+  }
+  return reduction;
 }
 
 /**
- * @brief getInfo
+ * @brief Reduces columns of nElements values each into a new Matlab array
  *
+ * With rowVector set the single column is returned as row like the data of
+ * read, otherwise there is one output column per input column like in
+ * read_seq. minmax returns the minima and maxima as rows 1 and 2 of a row
+ * vector result, and as pages 1 and 2 of a bins x columns x 2 array
+ * otherwise. The loops are kept simple, so the compiler can vectorise them.
  */
-void getInfo(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray**) {
-  if(nrhs > 0) mexWarnMsgTxt("Too many input arguments.");
-  if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
-  if(ChimeraTK::getDMapFilePath().empty()) {
-    mexErrMsgTxt("DMapFilePath not set. Use mtca4u.setDMapFilePath to configure it.");
+template<typename SourceType>
+mxArray* reduceToMxArray(
+    const Reduction& reduction, const std::vector<const SourceType*>& columns, size_t nElements, bool rowVector) {
+  const size_t nColumns = columns.size();
+  auto createMatrix = [&](size_t nRows, mxClassID classID) {
+    return rowVector ? mxCreateUninitNumericMatrix(1, nRows, classID, mxREAL) :
+                       mxCreateUninitNumericMatrix(nRows, nColumns, classID, mxREAL);
+  };
+
+  switch(reduction.kind) {
+    case Reduction::decimate: {
+      const size_t nRows = (nElements + reduction.n - 1) / reduction.n;
+      mxArray* value = createMatrix(nRows, getMxClassID<SourceType>());
+      SourceType* destination = static_cast<SourceType*>(mxGetData(value));
+      for(size_t c = 0; c < nColumns; ++c) {
+        for(size_t i = 0; i < nRows; ++i) destination[c * nRows + i] = columns[c][i * reduction.n];
+      }
+      return value;
+    }
+    case Reduction::mean:
+    case Reduction::rms: {
+      const size_t nRows = (nElements + reduction.n - 1) / reduction.n;
+      mxArray* value = createMatrix(nRows, mxDOUBLE_CLASS);
+      double* destination = mxGetPr(value);
+      for(size_t c = 0; c < nColumns; ++c) {
+        for(size_t i = 0; i < nRows; ++i) {
+          const SourceType* block = columns[c] + i * reduction.n;
+          const size_t blockSize = std::min(reduction.n, nElements - i * reduction.n);
+          double sum = 0;
+          if(reduction.kind == Reduction::mean) {
+            for(size_t j = 0; j < blockSize; ++j) sum += double(block[j]);
+            destination[c * nRows + i] = sum / blockSize;
+          }
+          else {
+            for(size_t j = 0; j < blockSize; ++j) sum += double(block[j]) * double(block[j]);
+            destination[c * nRows + i] = std::sqrt(sum / blockSize);
+          }
+        }
+      }
+      return value;
+    }
+    case Reduction::minmax: {
+      const size_t nBins = std::min(reduction.n, nElements);
+      mxArray* value;
+      if(rowVector) {
+        value = mxCreateUninitNumericMatrix(2, nBins, mxDOUBLE_CLASS, mxREAL);
+      }
+      else {
+        const mwSize dimensions[3] = {nBins, nColumns, 2};
+        value = mxCreateUninitNumericArray(3, dimensions, mxDOUBLE_CLASS, mxREAL);
+      }
+      double* destination = mxGetPr(value);
+      for(size_t c = 0; c < nColumns; ++c) {
+        double* minimum = rowVector ? destination : destination + c * nBins;
+        double* maximum = rowVector ? destination + 1 : destination + (nColumns + c) * nBins;
+        const size_t stride = rowVector ? 2 : 1;
+        for(size_t b = 0; b < nBins; ++b) {
+          const size_t begin = b * nElements / nBins, end = (b + 1) * nElements / nBins;
+          SourceType low = columns[c][begin], high = columns[c][begin];
+          for(size_t i = begin + 1; i < end; ++i) {
+            low = std::min(low, columns[c][i]);
+            high = std::max(high, columns[c][i]);
+          }
+          minimum[b * stride] = double(low);
+          maximum[b * stride] = double(high);
+        }
+      }
+      return value;
+    }
+    case Reduction::histogram: {
+      const std::vector<double>& edges = reduction.edges;
+      const size_t nBins = edges.size() - 1;
+      mxArray* value = createMatrix(nBins, mxDOUBLE_CLASS);
+      double* counts = mxGetPr(value);
+      std::fill(counts, counts + nBins * nColumns, 0.);
+      for(size_t c = 0; c < nColumns; ++c) {
+        for(size_t i = 0; i < nElements; ++i) {
+          const double x = double(columns[c][i]);
+          if(!((x >= edges.front()) && (x <= edges.back()))) continue; // also skips NaN
+          const size_t bin = std::min(size_t(std::upper_bound(edges.begin(), edges.end(), x) - edges.begin()) - 1, nBins - 1);
+          ++counts[c * nBins + bin];
+        }
+      }
+      return value;
+    }
+    case Reduction::none:
+      break;
   }
+  return NULL;
+}
 
-  ChimeraTK::DMapFileParser dMapFileParser;
-  auto dMap = dMapFileParser.parse(ChimeraTK::getDMapFilePath());
+/**
+ * @brief A register resolved once by the 'resolve' command
+ *
+ * It keeps the accessor alive, so read_h/write_h only do the transfer and the
+ * copy from/to the Matlab array.
+ */
+struct RegisterHandle {
+  explicit RegisterHandle(size_t deviceHandle_) : deviceHandle(deviceHandle_) {}
+  virtual ~RegisterHandle() = default;
+  virtual mxArray* read() = 0;
+  virtual void write(const mxArray* value) = 0;
+  size_t deviceHandle;
+};
 
-  mwSize dims[2] = {1, dMap->getSize()};
-  const char* field_names[] = {"name", "device", "firmware", "date", "map"};
-  plhs[0] = mxCreateStructArray(2, dims, (sizeof(field_names) / sizeof(*field_names)), field_names);
+template<typename UserType>
+struct RegisterHandleImpl : RegisterHandle {
+  RegisterHandleImpl(size_t deviceHandle_, OneDRegisterAccessor<UserType> accessor_)
+  : RegisterHandle(deviceHandle_), accessor(accessor_) {}
+
+  mxArray* read() override {
+    accessor.read();
+    mxArray* value = mxCreateUninitNumericMatrix(1, accessor.getNElements(), getMxClassID<UserType>(), mxREAL);
+    memcpy(mxGetData(value), accessor.data(), accessor.getNElements() * sizeof(UserType));
+    return value;
+  }
 
-  unsigned int i = 0;
+  void write(const mxArray* value) override {
+    // A partial write would send stale buffer content for the remaining elements
+    if(mxGetNumberOfElements(value) != accessor.getNElements())
+      mexErrMsgTxt("Number of elements does not match the register handle.");
+    copyFromMxArray(value, accessor.data(), accessor.getNElements());
+    accessor.write();
+  }
 
-  for(auto deviceInfo = dMap->begin(); deviceInfo != dMap->end(); ++deviceInfo, ++i) {
-    mxArray* firmware_value = mxCreateDoubleMatrix(1, 1, mxREAL);
-    *mxGetPr(firmware_value) = 0;
+  OneDRegisterAccessor<UserType> accessor;
+};
 
-    std::string date;
+// Key: device handle, register path, offset, elements, type
+typedef std::tuple<size_t, std::string, uint32_t, uint32_t, std::string> RegisterHandleKey;
 
-    try {
-      ChimeraTK::setDMapFilePath(deviceInfo->dmapFileName);
-      Device tempDevice;
-      tempDevice.open(deviceInfo->deviceName);
+/**
+ * @brief Slot of the register handle table
+ *
+ * Like device handles, the handle is slot + generation * maxRegisterHandleSlots,
+ * so a released handle is detected even if its slot has been reused.
+ */
+struct RegisterHandleSlot {
+  std::unique_ptr<RegisterHandle> handle; // NULL if the slot is free
+  size_t generation{0};
+};
 
-      int firmware = tempDevice.read<int>("BOARD0/WORD_FIRMWARE");
-      *mxGetPr(firmware_value) = firmware;
+const size_t maxRegisterHandleSlots = 1 << 20;
 
-      int timestamp = tempDevice.read<int>("BOARD0/WORD_TIMESTAMP");
-      date = timestamp;
-    }
-    catch(...) {
-    }
+std::vector<RegisterHandleSlot> registerHandleSlotsVector;
+std::vector<size_t> freeRegisterHandleSlots;
+std::map<RegisterHandleKey, size_t> registerHandlesMap; // value: register handle
 
-    mxSetFieldByNumber(plhs[0], i, 0, mxCreateString(deviceInfo->deviceName.c_str()));
-    mxSetFieldByNumber(plhs[0], i, 1, mxCreateString(deviceInfo->uri.c_str()));
-    mxSetFieldByNumber(plhs[0], i, 2, firmware_value);
-    mxSetFieldByNumber(plhs[0], i, 3, mxCreateString(date.c_str()));
-    mxSetFieldByNumber(plhs[0], i, 4, mxCreateString(deviceInfo->mapFileName.c_str()));
-  }
-}
+RegisterHandle& getRegisterHandle(const mxArray* prhsHandle);
+void releaseRegisterHandles(size_t deviceHandle);
 
-std::string getFundamentalTypeString(ChimeraTK::DataDescriptor::FundamentalType fundamentalType) {
-  if(fundamentalType == DataDescriptor::FundamentalType::numeric) return "numeric";
-  if(fundamentalType == DataDescriptor::FundamentalType::string) return "string";
-  if(fundamentalType == DataDescriptor::FundamentalType::boolean) return "boolean";
-  if(fundamentalType == DataDescriptor::FundamentalType::nodata) return "nodata";
-  if(fundamentalType == DataDescriptor::FundamentalType::undefined) return "undefined";
-  return "unknown";
-}
+// Register catalogues
 
 /**
- * @brief getDeviceInfo
- *
+ * @brief The register information needed by device_info, register_info and register_size
  */
-void getDeviceInfo(unsigned int nlhs, mxArray** plhs, unsigned int nrhs, const mxArray* prhs[]) {
-  if(nrhs < 1) mexErrMsgTxt("Not enough input arguments.");
-  if(nrhs > 1) mexWarnMsgTxt("Too many input arguments.");
-  if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
+struct CachedRegisterInfo {
+  std::string name;
+  size_t nElementsPerChannel;
+  size_t nChannels;
+  size_t nDimensions;
+  DataDescriptor dataDescriptor;
+};
 
-  boost::shared_ptr<Device> device = getDevice(prhs[0]);
+/**
+ * @brief Copy of the register catalogue of a device with an index by register path
+ */
+struct CachedRegisterCatalogue {
+  std::vector<CachedRegisterInfo> registers; // in the order of the catalogue
+  std::unordered_map<std::string, size_t> index;
 
-  auto registerCatalogue = device->getRegisterCatalogue();
+  const CachedRegisterInfo& getRegister(const RegisterPath& registerPath) const;
+};
+
+// The catalogue of a device is read once and dropped when the device is closed
+std::map<size_t, CachedRegisterCatalogue> registerCataloguesMap;
+
+const CachedRegisterCatalogue& getRegisterCatalogue(const mxArray* prhsDevice);
+
+// Native threads
+
+/**
+ * @brief Stop request for a native thread, which also serves as its interruptible sleep
+ */
+class StopSignal {
+ public:
+  void request() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      requested = true;
+    }
+    condition.notify_all();
+  }
+
+  /// Sleeps until the given time or the stop request, returns true if stop has been requested
+  template<typename TimePoint>
+  bool waitUntil(const TimePoint& time) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return condition.wait_until(lock, time, [this] { return requested; });
+  }
+
+  /// Sleeps for the given duration or until the stop request, returns true if stop has been requested
+  template<typename Duration>
+  bool waitFor(const Duration& duration) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return condition.wait_for(lock, duration, [this] { return requested; });
+  }
+
+ private:
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool requested{false};
+};
+
+/**
+ * @brief Current system time as posix time in seconds
+ */
+double getPosixTime() {
+  return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Continuous acquisitions
+
+/**
+ * @brief A register read continuously by a native thread
+ *
+ * The thread is the only producer and acq_fetch the only consumer of a
+ * preallocated ring buffer of blocks, so no lock is needed on the data path.
+ */
+class Acquisition {
+ public:
+  Acquisition(size_t deviceHandle_, std::shared_ptr<std::mutex> transferMutex_, OneDRegisterAccessor<double> accessor_,
+      double period_, size_t capacity_);
+  ~Acquisition();
+
+  /// Copies all blocks accumulated since the last call into new Matlab arrays
+  void fetch(mxArray** data, mxArray** timestamps);
+
+  /// Number of blocks dropped since the last call
+  size_t takeOverruns() { return overruns.exchange(0); }
+
+  /// Error message if the thread has terminated because of an exception
+  std::string getError();
+
+  void stop();
+
+  const size_t deviceHandle;
+
+ private:
+  void run();
+
+  /// Appends the current accessor data to the ring buffer
+  void storeBlock();
+
+  std::shared_ptr<std::mutex> transferMutex; // see SharedDevice
+  OneDRegisterAccessor<double> accessor;
+  const std::chrono::duration<double> period; // zero for wait_for_new_data
+  const size_t capacity;
+  const size_t nElements;
+
+  std::vector<double> buffer;     // capacity blocks of nElements
+  std::vector<double> timestamps; // one posix time per block
+
+  // Both are running block counters, the ring index is the counter modulo capacity
+  std::atomic<size_t> head{0}; // written by the thread
+  std::atomic<size_t> tail{0}; // written by acq_fetch
+  std::atomic<size_t> overruns{0};
+
+  StopSignal stopSignal;
+
+  std::mutex errorMutex;
+  std::string error;
+
+  std::thread thread;
+};
+
+std::vector<std::unique_ptr<Acquisition>> acquisitionsVector;
+
+void stopAcquisitions(size_t deviceHandle);
+void cleanUp();
+
+// Push-type accessors
+
+/**
+ * @brief A cached accessor with AccessMode::wait_for_new_data for read_wait
+ */
+struct PushAccessor {
+  OneDRegisterAccessor<double> accessor;
+};
+
+// Key: device handle, register path
+std::map<std::pair<size_t, std::string>, PushAccessor> pushAccessorsMap;
+
+void releasePushAccessors(size_t deviceHandle);
+
+// Recordings
+
+/*
+ * File layout of a recording. All values are in host byte order and all
+ * sections start at multiples of 8 bytes:
+ *  - RecordFileHeader
+ *  - for each register: RecordRegisterHeader, followed by the register name
+ *  - from headerSize on: blocks of blockSize bytes, each with the posix time
+ *    as double followed by the data of each register. The data of a register
+ *    is nElementsPerChannel values of its class for each channel.
+ * The number of blocks follows from the file size, so the file stays valid if
+ * the recording is interrupted.
+ */
+struct RecordFileHeader {
+  char magic[8]; // "MTCA4REC"
+  uint32_t formatVersion;
+  uint32_t nRegisters;
+  uint64_t headerSize;
+  uint64_t blockSize;
+};
+
+struct RecordRegisterHeader {
+  char className[8]; // Matlab class name, zero padded
+  uint32_t nChannels;
+  uint32_t nElementsPerChannel;
+  uint32_t nameLength;
+  uint32_t reserved;
+};
+
+const char recordMagic[8] = {'M', 'T', 'C', 'A', '4', 'R', 'E', 'C'};
+const uint32_t recordFormatVersion = 1;
+
+/**
+ * @brief A register of a recording. The derived template holds the typed accessor.
+ */
+struct RecordedRegister {
+  virtual ~RecordedRegister() = default;
+  virtual TransferElementAbstractor& getAccessor() = 0;
+  /// Copies the content of the accessor channel by channel
+  virtual void copyTo(char* destination) = 0;
+
+  std::string name;
+  mxClassID classID;
+  size_t nChannels;
+  size_t nElementsPerChannel;
+  size_t elementSize;
+};
+
+template<typename UserType>
+struct RecordedRegisterImpl : RecordedRegister {
+  TransferElementAbstractor& getAccessor() override { return accessor; }
+
+  void copyTo(char* destination) override {
+    for(size_t channel = 0; channel < nChannels; ++channel) {
+      memcpy(destination + channel * nElementsPerChannel * sizeof(UserType), accessor[channel].data(),
+          nElementsPerChannel * sizeof(UserType));
+    }
+  }
+
+  TwoDRegisterAccessor<UserType> accessor;
+};
+
+/**
+ * @brief Periodically reads a set of registers with one TransferGroup and appends the blocks to a file
+ */
+class Recorder {
+ public:
+  Recorder(size_t deviceHandle_, std::shared_ptr<std::mutex> transferMutex_,
+      std::vector<std::unique_ptr<RecordedRegister>> registers_, FILE* file_, double period_);
+  ~Recorder();
+
+  /// Stops the thread and closes the file
+  void stop();
+
+  size_t getNumberOfBlocks() const { return nBlocks; }
+
+  /// Error message if the thread has terminated because of an exception
+  std::string getError();
+
+  const size_t deviceHandle;
+
+ private:
+  void run();
+
+  std::shared_ptr<std::mutex> transferMutex; // see SharedDevice
+  std::vector<std::unique_ptr<RecordedRegister>> registers;
+  TransferGroup group;
+  FILE* file;
+  const std::chrono::duration<double> period;
+  std::vector<char> block;
+  std::atomic<size_t> nBlocks{0};
+
+  StopSignal stopSignal;
+
+  std::mutex errorMutex;
+  std::string error;
+
+  std::thread thread;
+};
+
+std::vector<std::unique_ptr<Recorder>> recordersVector;
+
+void stopRecordings(size_t deviceHandle);
+
+// Device probing for info
+
+/**
+ * @brief Firmware and timestamp of a device, read by a probe thread
+ */
+struct DeviceProbe {
+  std::mutex mutex;
+  std::condition_variable finished;
+  bool done{false};
+  bool valid{false};
+  int firmware{0};
+  int timestamp{0};
+  std::chrono::steady_clock::time_point doneTime; // to rate-limit the retries of failed probes
+};
+
+/**
+ * @brief Parsed dmap file and probe results, valid as long as the dmap file is not modified
+ */
+struct DeviceInfoCache {
+  std::string dmapFilePath;
+  struct timespec modificationTime {};
+  boost::shared_ptr<DeviceInfoMap> dMap;
+  std::map<std::string, std::shared_ptr<DeviceProbe>> probes;
+};
+
+DeviceInfoCache deviceInfoCache;
+
+// Probe threads cannot be interrupted while opening a device. They are only
+// joined when finished, and the mex file is locked while any of them runs, so
+// it is not unloaded below a running thread.
+std::vector<std::pair<std::shared_ptr<DeviceProbe>, std::thread>> probeThreads;
+bool probesLockMex = false;
+
+void joinProbeThreads();
+
+const double defaultProbeTimeout = 2.; // seconds
+const double probeRetryInterval = 30.; // seconds until a failed probe is started again
+
+// Seconds without progress of an mtca4u_server until a connect or request fails
+const double defaultRemoteTimeout = 5.;
+
+// Defaults of the capture command
+const double defaultCaptureTimeout = 10.; // seconds
+const double defaultCaptureSpin = 1000.;  // polls before sleeping between polls
+const double defaultCaptureSleep = 1e-4;  // seconds
+
+/**
+ * @brief Fixed set of native threads executing queued tasks
+ *
+ * The threads are started with the first task and run until the mex file is
+ * cleared. Tasks must not call the Matlab API, as it is not thread safe.
+ */
+class WorkerPool {
+ public:
+  explicit WorkerPool(size_t nThreads_) : nThreads(nThreads_) {}
+  ~WorkerPool() { stop(); }
+
+  void submit(std::function<void()> task);
+
+  /// Finishes the queued tasks and joins the threads
+  void stop();
+
+ private:
+  void run();
+
+  const size_t nThreads;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::deque<std::function<void()>> tasks;
+  std::vector<std::thread> threads;
+  bool stopping{false};
+};
+
+WorkerPool workerPool(8);
+
+/**
+ * @brief A read running on the worker pool, see readAsync
+ *
+ * The accessor is created by read_async, only its transfer runs on a worker
+ * and the copy into the Matlab array is done by read_fetch, so the Matlab
+ * API is only used from the Matlab thread.
+ */
+struct ReadTicket {
+  size_t deviceHandle;
+  RegisterPath registerPath;
+  size_t nBytes;
+  std::function<void()> transfer;   // called on a worker
+  std::function<mxArray*()> convert; // called by read_fetch
+
+  std::mutex mutex;
+  std::condition_variable finishedCondition;
+  bool finished{false};
+  std::string error;
+};
+
+// Key: ticket, which are not reused within a session
+std::map<size_t, std::shared_ptr<ReadTicket>> readTicketsMap;
+size_t nextReadTicket = 1;
+
+void releaseReadTickets(size_t deviceHandle);
+
+/**
+ * @brief Connection to an mtca4u_server, see mtca4u_protocol.h
+ *
+ * The transports only move bytes, the frames are the same for all of them.
+ */
+class RemoteConnection {
+ public:
+  virtual ~RemoteConnection() {}
+
+  /// Transfers as many bytes as possible without blocking, returns -1 if the connection is broken
+  virtual ssize_t sendSome(const char* data, size_t size) = 0;
+  virtual ssize_t receiveSome(char* data, size_t size) = 0;
+
+  /// Blocks until sending (if sending is set) or receiving may progress or a short while has passed, returns false if
+  /// the connection is broken
+  virtual bool wait(bool sending) = 0;
+
+  /// Copies an array out of a bulk segment of the broker
+  virtual void copyBulk(const std::string&, char*, size_t) { throw std::runtime_error("Malformed frame."); }
+
+  /// True if the server is known to be alive, so a request without progress is not timed out
+  virtual bool isServerAlive() { return false; }
+
+  uint32_t nextRequestId{0};
+  double timeout{defaultRemoteTimeout}; // seconds without progress until a request fails
+};
+
+/**
+ * @brief Connection over a tcp or unix socket
+ */
+class SocketConnection : public RemoteConnection {
+ public:
+  explicit SocketConnection(int fd_) : fd(fd_) {}
+  ~SocketConnection() { ::close(fd); }
+  ssize_t sendSome(const char* data, size_t size) override;
+  ssize_t receiveSome(char* data, size_t size) override;
+  bool wait(bool sending) override;
+
+ private:
+  int fd;
+};
+
+/**
+ * @brief Connection to the broker on the same host over shared memory, see mtca4u_shm.h
+ */
+class ShmConnection : public RemoteConnection {
+ public:
+  ~ShmConnection();
+  /// Claims a slot of the broker, returns NULL with the reason in errorMessage on failure
+  static ShmConnection* connect(const std::string& address, std::string& errorMessage);
+  ssize_t sendSome(const char* data, size_t size) override;
+  ssize_t receiveSome(char* data, size_t size) override;
+  bool wait(bool sending) override;
+  void copyBulk(const std::string& name, char* destination, size_t size) override;
+  bool isServerAlive() override;
+
+ private:
+  /// Unmaps the cached segments the broker has removed in the meantime
+  void pruneSegments();
+
+  std::string registryName;
+  mtca4u_protocol::ShmRegistry* registry{NULL};
+  mtca4u_protocol::ShmSlot* slot{NULL};
+  std::map<std::string, std::pair<char*, size_t>> segments; // mapped bulk segments with their mapped size
+};
+
+// Key: connection handle, which are not reused within a session
+std::map<size_t, std::unique_ptr<RemoteConnection>> remoteConnectionsMap;
+size_t nextRemoteConnectionHandle = 1;
+
+/*
+ * Performance counters of the commands. A call is split into the phases
+ * parse (from entering the mex function until the first other phase),
+ * accessor setup, transfer and conversion into/from the Matlab array.
+ * The counters are only updated from the Matlab thread, so no locking is needed.
+ */
+enum StatsPhase { phaseParse, phaseSetup, phaseTransfer, phaseConversion, nStatsPhases };
+const char* const statsPhaseNames[nStatsPhases] = {"parse", "setup", "transfer", "conversion"};
+
+// Bin i counts latencies below 2^i microseconds, the last bin the rest
+const size_t nStatsHistogramBins = 24;
+
+struct TimeStats {
+  uint64_t count{0};
+  double total{0}, min{0}, max{0};
+  uint64_t histogram[nStatsHistogramBins]{};
+
+  void add(double seconds);
+  mxArray* toMxArray() const;
+};
+
+struct CommandStats {
+  uint64_t calls{0};
+  TimeStats total;
+  TimeStats phases[nStatsPhases];
+};
+
+struct TransferStats {
+  uint64_t transfers{0};
+  uint64_t bytes{0};
+};
+
+class Statistics {
+ public:
+  /// Called when the mex function is entered, starts the parse phase
+  void begin();
+  /// Ends the running phase and starts the given one
+  void phase(StatsPhase next);
+  /// Called when the command has returned successfully
+  void end(size_t command);
+  /// Device handle of the running call, set by getDevice
+  void setDevice(size_t deviceHandle);
+  void addBytes(const RegisterPath& registerPath, size_t bytes);
+  void reset();
+  mxArray* toMxArray() const;
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point callStart, phaseStart;
+  StatsPhase currentPhase{phaseParse};
+  double phaseTimes[nStatsPhases]{};
+  bool phaseUsed[nStatsPhases]{};
+  /// No device set in the running call, shown as NaN in the transfers
+  static constexpr size_t noDevice = size_t(-1);
+  size_t currentDevice{noDevice};
+
+  std::vector<CommandStats> commandStats;
+  std::map<std::pair<size_t, std::string>, TransferStats> transferStats;
+};
+
+Statistics statistics;
+
+/*
+ * Optional trace of the single calls for latency analysis. While enabled,
+ * the statistics hooks add fixed size records to a ring buffer, so only the
+ * newest records are kept. trace_dump writes them as Chrome trace-event JSON.
+ */
+const size_t defaultTraceCapacity = 1 << 16; // records
+
+struct TraceRecord {
+  enum Kind : uint8_t { call, phase, device, transfer };
+  Kind kind;
+  uint32_t id;            // command index, StatsPhase or register id
+  double start, duration; // microseconds since trace_start
+  size_t deviceHandle;    // call and device records
+  bool hasDevice;
+  uint64_t bytes;         // call and transfer records
+};
+
+class Trace {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  /// Clears the buffer and starts recording
+  void start(size_t capacity);
+  void stop() { enabled = false; }
+  bool isEnabled() const { return enabled; }
+
+  void beginCall();
+  void addPhase(StatsPhase phase, Clock::time_point begin, Clock::time_point end);
+  void addDevice(size_t deviceHandle);
+  void addTransfer(const RegisterPath& registerPath, size_t bytes);
+  void endCall(size_t command, Clock::time_point begin, Clock::time_point end);
+
+  /// Writes the records as JSON, returns the number of events or -1 on a write error
+  long dump(FILE* file) const;
+
+ private:
+  TraceRecord& nextRecord() { return records[nRecords++ % records.size()]; }
+  double toMicroseconds(Clock::time_point t) const {
+    return std::chrono::duration<double, std::micro>(t - epoch).count();
+  }
+
+  bool enabled{false};
+  Clock::time_point epoch;
+  std::vector<TraceRecord> records;
+  uint64_t nRecords{0}; // all records ever added, the ring index is this modulo the capacity
+
+  // Of the running call
+  size_t callDevice{0};
+  bool callHasDevice{false};
+  uint64_t callBytes{0};
+
+  // Register names are stored once, the records only hold their index
+  std::vector<std::string> registerNames;
+  std::unordered_map<std::string, uint32_t> registerIds;
+};
+
+Trace trace;
+
+// Command Function declarations and stuff
+
+typedef void (*CmdFnc)(unsigned int, mxArray**, unsigned int, const mxArray**);
+
+struct Command {
+  string Name;
+  CmdFnc pCallback;
+  string Description;
+  string Example;
+  Command(string n, CmdFnc p, string d, string e) : Name(n), pCallback(p), Description(d), Example(e){};
+};
+
+void PrintHelp(unsigned int, mxArray**, unsigned int, const mxArray**);
+void getVersion(unsigned int, mxArray**, unsigned int, const mxArray**);
+void openDevice(unsigned int, mxArray**, unsigned int, const mxArray**);
+void closeDevice(unsigned int, mxArray**, unsigned int, const mxArray**);
+void getInfo(unsigned int, mxArray**, unsigned int, const mxArray**);
+void getDeviceInfo(unsigned int, mxArray**, unsigned int, const mxArray**);
+void getRegisterInfo(unsigned int, mxArray**, unsigned int, const mxArray**);
+void getRegisterSize(unsigned int, mxArray**, unsigned int, const mxArray**);
+void readRegister(unsigned int, mxArray**, unsigned int, const mxArray**);
+void writeRegister(unsigned int, mxArray**, unsigned int, const mxArray**);
+void readDmaRaw(unsigned int, mxArray**, unsigned int, const mxArray**);
+void readSequence(unsigned int, mxArray**, unsigned int, const mxArray**);
+void setDMapFilePath(unsigned int, mxArray**, unsigned int, const mxArray**);
+void getDMapFilePath(unsigned int, mxArray**, unsigned int, const mxArray**);
+void readRaw(unsigned int, mxArray**, unsigned int, const mxArray**);
+void resolveRegister(unsigned int, mxArray**, unsigned int, const mxArray**);
+void readRegisterHandle(unsigned int, mxArray**, unsigned int, const mxArray**);
+void writeRegisterHandle(unsigned int, mxArray**, unsigned int, const mxArray**);
+void getOpcode(unsigned int, mxArray**, unsigned int, const mxArray**);
+void readMany(unsigned int, mxArray**, unsigned int, const mxArray**);
+void setReadChunkSize(unsigned int, mxArray**, unsigned int, const mxArray**);
+void getReadChunkSize(unsigned int, mxArray**, unsigned int, const mxArray**);
+void startAcquisition(unsigned int, mxArray**, unsigned int, const mxArray**);
+void fetchAcquisition(unsigned int, mxArray**, unsigned int, const mxArray**);
+void stopAcquisition(unsigned int, mxArray**, unsigned int, const mxArray**);
+void readWait(unsigned int, mxArray**, unsigned int, const mxArray**);
+void startRecording(unsigned int, mxArray**, unsigned int, const mxArray**);
+void stopRecording(unsigned int, mxArray**, unsigned int, const mxArray**);
+void openRecording(unsigned int, mxArray**, unsigned int, const mxArray**);
+void getStats(unsigned int, mxArray**, unsigned int, const mxArray**);
+void resetStats(unsigned int, mxArray**, unsigned int, const mxArray**);
+void findRegisters(unsigned int, mxArray**, unsigned int, const mxArray**);
+void writeRaw(unsigned int, mxArray**, unsigned int, const mxArray**);
+void convertDoubleToUnsigned(unsigned int, mxArray**, unsigned int, const mxArray**);
+void convertUnsignedToDouble(unsigned int, mxArray**, unsigned int, const mxArray**);
+void convertDoubleToSigned(unsigned int, mxArray**, unsigned int, const mxArray**);
+void convertSignedToDouble(unsigned int, mxArray**, unsigned int, const mxArray**);
+void connectRemote(unsigned int, mxArray**, unsigned int, const mxArray**);
+void requestRemote(unsigned int, mxArray**, unsigned int, const mxArray**);
+void disconnectRemote(unsigned int, mxArray**, unsigned int, const mxArray**);
+void capture(unsigned int, mxArray**, unsigned int, const mxArray**);
+void writeMany(unsigned int, mxArray**, unsigned int, const mxArray**);
+void readMultiDevice(unsigned int, mxArray**, unsigned int, const mxArray**);
+void readAsync(unsigned int, mxArray**, unsigned int, const mxArray**);
+void readReady(unsigned int, mxArray**, unsigned int, const mxArray**);
+void readFetch(unsigned int, mxArray**, unsigned int, const mxArray**);
+void startTrace(unsigned int, mxArray**, unsigned int, const mxArray**);
+void stopTrace(unsigned int, mxArray**, unsigned int, const mxArray**);
+void dumpTrace(unsigned int, mxArray**, unsigned int, const mxArray**);
+
+vector<Command> vectorOfCommands = {Command("help", &PrintHelp, "", ""), Command("version", &getVersion, "", ""),
+    Command("nop", NULL, "", ""), Command("open", &openDevice, "", ""), Command("close", &closeDevice, "", ""),
+    Command("info", &getInfo, "", ""), Command("device_info", &getDeviceInfo, "", ""),
+    Command("register_info", &getRegisterInfo, "", ""), Command("register_size", &getRegisterSize, "", ""),
+    Command("read", &readRegister, "", ""), Command("write", &writeRegister, "", ""),
+    Command("read_dma_raw", &readDmaRaw, "", ""), Command("read_seq", &readSequence, "", ""),
+    Command("set_dmap", &setDMapFilePath, "", ""), Command("get_dmap", &getDMapFilePath, "", ""),
+    Command("read_raw", &readRaw, "", ""), Command("resolve", &resolveRegister, "", ""),
+    Command("read_h", &readRegisterHandle, "", ""), Command("write_h", &writeRegisterHandle, "", ""),
+    Command("opcode", &getOpcode, "", ""), Command("read_many", &readMany, "", ""),
+    Command("set_chunk_size", &setReadChunkSize, "", ""), Command("get_chunk_size", &getReadChunkSize, "", ""),
+    Command("acq_start", &startAcquisition, "", ""), Command("acq_fetch", &fetchAcquisition, "", ""),
+    Command("acq_stop", &stopAcquisition, "", ""), Command("read_wait", &readWait, "", ""),
+    Command("record_start", &startRecording, "", ""), Command("record_stop", &stopRecording, "", ""),
+    Command("record_open", &openRecording, "", ""), Command("stats", &getStats, "", ""),
+    Command("stats_reset", &resetStats, "", ""), Command("find_registers", &findRegisters, "", ""),
+    Command("write_raw", &writeRaw, "", ""), Command("cd2ui", &convertDoubleToUnsigned, "", ""),
+    Command("cui2d", &convertUnsignedToDouble, "", ""), Command("cd2si", &convertDoubleToSigned, "", ""),
+    Command("csi2d", &convertSignedToDouble, "", ""), Command("remote_connect", &connectRemote, "", ""),
+    Command("remote_request", &requestRemote, "", ""), Command("remote_disconnect", &disconnectRemote, "", ""),
+    Command("capture", &capture, "", ""), Command("write_many", &writeMany, "", ""),
+    Command("read_multi_device", &readMultiDevice, "", ""), Command("read_async", &readAsync, "", ""),
+    Command("read_ready", &readReady, "", ""), Command("read_fetch", &readFetch, "", ""),
+    Command("trace_start", &startTrace, "", ""), Command("trace_stop", &stopTrace, "", ""),
+    Command("trace_dump", &dumpTrace, "", "")};
+
+// Index of each command name in vectorOfCommands. The index is also the
+// numeric opcode, so new commands must be appended at the end.
+std::unordered_map<std::string, size_t> commandIndexMap;
+
+const Command* findCommand(const mxArray* prhsCommand);
+
+/**
+ * @brief Mex Entry Function
+ *
+ * @param[in] nlhs Number of left hand side parameter
+ * @param[inout] phls Pointer to the left hand side parameter
+ * @param[in] rhhs Numer of the right hand side parameter
+ * @param[inout] prhs Pointer to the right hand side parameter
+ *
+ */
+void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]) {
+  // Initalize basic stuff
+  if(isInit == false) {
+    // Setting devices.dmap as default is just for convenience. Some scripts
+    // might rely on it.
+    // DeviceAccess from 01.00 is throwing if the file is not there.
+    // We just catch the exception and continue. The user will set his own
+    // dmap file later if needed.
+    try {
+      ChimeraTK::setDMapFilePath("./devices.dmap");
+    }
+    catch(ChimeraTK::logic_error&) {
+    }
+
+    for(size_t i = 0; i < vectorOfCommands.size(); ++i) {
+      commandIndexMap[vectorOfCommands[i].Name] = i;
+    }
+
+    // Native threads must be stopped before the mex file is unloaded
+    mexAtExit(&cleanUp);
+
+    isInit = true;
+  }
+
+  if(nrhs == 0) {
+    mexErrMsgTxt("Not enough input arguments.");
+    return;
+  }
+
+  statistics.begin();
+
+  // Left over if the previous command has been aborted by mexErrMsgTxt
+  commandDeviceLock.release();
+  // Unlocks the mex file once the last probe thread has finished
+  if(!probeThreads.empty()) joinProbeThreads();
+
+  try {
+    const Command* command = findCommand(prhs[0]);
+
+    // Check if the method is implemented
+    if(NULL == command->pCallback) {
+      mexErrMsgTxt("Command not implemented yet.");
+      return;
+    }
+
+    // Ok run method
+    command->pCallback(nlhs, plhs, nrhs - 1, &prhs[1]);
+
+    commandDeviceLock.release();
+
+    // Failed calls are not counted, and the stats must not count themselves
+    if(command->pCallback != &getStats) statistics.end(command - vectorOfCommands.data());
+  }
+
+  catch(ChimeraTK::runtime_error& e) {
+    commandDeviceLock.release();
+    mexErrMsgTxt(e.what());
+  }
+  catch(ChimeraTK::logic_error& e) {
+    commandDeviceLock.release();
+    mexErrMsgTxt(e.what());
+  }
+  catch(...) {
+    commandDeviceLock.release();
+    throw;
+  }
+}
+
+/**
+ * @brief Looks up the command given as first argument
+ *
+ * The command is either its name or its numeric opcode as integer class
+ * scalar (see 'opcode'). Passing the opcode avoids the string conversion.
+ */
+const Command* findCommand(const mxArray* prhsCommand) {
+  if(mxIsRealScalar(prhsCommand) && !mxIsDouble(prhsCommand) && (mxGetClassID(prhsCommand) != mxSINGLE_CLASS)) {
+    const double opcode = mxGetScalar(prhsCommand);
+    if((opcode < 0) || (opcode >= vectorOfCommands.size())) mexErrMsgTxt("Unknown opcode.");
+    return &vectorOfCommands[size_t(opcode)];
+  }
+
+  if(!mxIsChar(prhsCommand)) mexErrMsgTxt("Invalid input arguments.");
+
+  // Command names are short, so we can use a buffer on the stack instead of mxArrayToString.
+  // A truncated name cannot match any command.
+  char buffer[64];
+  if(mxGetString(prhsCommand, buffer, sizeof(buffer)) == 0) {
+    std::string cmd(buffer);
+    auto it = commandIndexMap.find(cmd);
+    if(it == commandIndexMap.end()) {
+      transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
+      it = commandIndexMap.find(cmd);
+    }
+    if(it != commandIndexMap.end()) return &vectorOfCommands[it->second];
+  }
+
+  mexErrMsgTxt("Unknown command '" + mxArrayToStdString(prhsCommand) +
+      "'. Use mtca4u('help') to show some help information.");
+  return NULL;
+}
+
+/**
+ * @brief Returns the numeric opcode of a command
+ *
+ * Parameter: command
+ */
+void getOpcode(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  if(nrhs < 1) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 1) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
+
+  if(!mxIsChar(prhs[0])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(1) + " input argument.");
+
+  const Command* command = findCommand(prhs[0]);
+
+  plhs[0] = mxCreateNumericMatrix(1, 1, mxUINT32_CLASS, mxREAL);
+  *static_cast<uint32_t*>(mxGetData(plhs[0])) = command - vectorOfCommands.data();
+}
+
+void getDMapFilePath(unsigned int, mxArray* plhs[], unsigned int, const mxArray**) {
+  plhs[0] = mxCreateString((BackendFactory::getInstance().getDMapFilePath()).c_str());
+}
+
+/**
+ * @brief setDMapFilePath
+ *
+ */
+void setDMapFilePath(unsigned int, mxArray**, unsigned int nrhs, const mxArray* prhs[]) {
+  if(nrhs < 1) mexErrMsgTxt("Not enough input params.");
+  if(nrhs > 1) mexWarnMsgTxt("Too many input arguments.");
+  std::string dMapFile = mxArrayToStdString(prhs[0]);
+  ChimeraTK::setDMapFilePath(dMapFile);
+}
+
+/**
+ * @brief getDevice
+ *
+ * @param[in] dmapFileName File to be loaded or all in the current directory if
+ * empty
+ *
+ */
+boost::shared_ptr<Device> getDevice(const mxArray* prhsDevice) {
+  if(!mxIsRealScalar(prhsDevice)) mexErrMsgTxt("Invalid device handle.");
+
+  const size_t deviceHandle = mxGetScalar(prhsDevice);
+
+  if(deviceHandle % maxDeviceSlots >= deviceSlotsVector.size()) mexErrMsgTxt("Invalid device handle.");
+
+  DeviceSlot* slot = findDeviceSlot(deviceHandle);
+  if(!slot) mexErrMsgTxt("Device closed.");
+
+  commandDeviceLock.lock(slot->transferMutex);
+  statistics.setDevice(deviceHandle);
+  return slot->device;
+}
+
+/**
+ * @brief Returns the slot of an open device handle, NULL if the handle is invalid or closed
+ */
+DeviceSlot* findDeviceSlot(size_t deviceHandle) {
+  const size_t slotIndex = deviceHandle % maxDeviceSlots;
+  if(slotIndex >= deviceSlotsVector.size()) return NULL;
+  DeviceSlot& slot = deviceSlotsVector[slotIndex];
+  if(!slot.device || (slot.generation != deviceHandle / maxDeviceSlots)) return NULL;
+  return &slot;
+}
+
+/**
+ * @brief PrintHelp shows the help text on the console
+ *
+ */
+void PrintHelp(unsigned int, mxArray**, unsigned int, const mxArray**) {
+  mexPrintf(std::string("mtca4u Matlab library revision: ") + gVersion + "\n");
+  mexPrintf("Available Commands are: \n");
+
+  for(vector<Command>::iterator it = vectorOfCommands.begin(); it != vectorOfCommands.end(); ++it) {
+    mexPrintf("\t" + it->Name + "\n");
+  }
+  mexPrintf("\n\nFor further help or bug reports please contact "
+            "chimeratk-support@desy.de\n");
+}
+
+/**
+ * @brief Returns the version as a number
+ *
+ */
+void getVersion(unsigned int, mxArray* plhs[], unsigned int, const mxArray**) {
+  plhs[0] = mxCreateString(gVersion.c_str());
+}
+
+/**
+ * @brief Force to open the device
+ *
+ */
+void openDevice(unsigned int, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  if(nrhs < 1) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 1) mexWarnMsgTxt("Too many input arguments.");
+
+  std::string deviceName = mxArrayToStdString(prhs[0]);
+  DeviceName name(ChimeraTK::getDMapFilePath(), deviceName);
+
+  if(freeDeviceSlots.empty() && (deviceSlotsVector.size() >= maxDeviceSlots)) mexErrMsgTxt("Too many open devices.");
+
+  // All handles of an alias share one opened device
+  SharedDevice& sharedDevice = sharedDevicesMap[name];
+  if(!sharedDevice.device) {
+    boost::shared_ptr<Device> device(new Device());
+    try {
+      device->open(deviceName);
+    }
+    catch(...) {
+      sharedDevicesMap.erase(name);
+      throw;
+    }
+    sharedDevice.device = device;
+  }
+  ++sharedDevice.references;
+
+  size_t slotIndex;
+  if(!freeDeviceSlots.empty()) {
+    slotIndex = freeDeviceSlots.back();
+    freeDeviceSlots.pop_back();
+  }
+  else {
+    slotIndex = deviceSlotsVector.size();
+    deviceSlotsVector.emplace_back();
+  }
+  DeviceSlot& slot = deviceSlotsVector[slotIndex];
+  slot.device = sharedDevice.device;
+  slot.name = name;
+  slot.transferMutex = sharedDevice.transferMutex;
+
+  plhs[0] = mxCreateDoubleMatrix(1, 1, mxREAL);
+  (*mxGetPr(plhs[0])) = slotIndex + slot.generation * maxDeviceSlots;
+
+#ifdef __MEX_DEBUG_MODE
+  mexPrintf("Successfully opened " + deviceName + "\n");
+#endif
+}
+
+/**
+ * @brief Closes a open device
+ *
+ */
+void closeDevice(unsigned int, mxArray**, unsigned int nrhs, const mxArray* prhs[]) {
+  if(nrhs < 1) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 1) mexWarnMsgTxt("Too many input arguments.");
+
+  if(!mxIsRealScalar(prhs[0])) mexErrMsgTxt("Invalid device handle.");
+
+  const size_t deviceHandle = mxGetScalar(prhs[0]);
+
+  if(deviceHandle % maxDeviceSlots >= deviceSlotsVector.size()) mexErrMsgTxt("Invalid device handle.");
+
+  // Closing a handle twice is not an error
+  DeviceSlot* slot = findDeviceSlot(deviceHandle);
+  if(!slot) return;
+
+  // Cached accessors and acquisitions must not outlive the handle
+  releaseRegisterHandles(deviceHandle);
+  registerCataloguesMap.erase(deviceHandle);
+  stopAcquisitions(deviceHandle);
+  releasePushAccessors(deviceHandle);
+  stopRecordings(deviceHandle);
+  releaseReadTickets(deviceHandle);
+  chunkAccessors.reset();
+
+  // The backend factory will keep a copy, so a rebot backend for instance will
+  // keep the device occupied if we just reset the device object. So we have to
+  // really close it when the last handle of the alias is closed.
+  auto sharedDevice = sharedDevicesMap.find(slot->name);
+  if(--sharedDevice->second.references == 0) {
+    sharedDevice->second.device->close();
+    sharedDevicesMap.erase(sharedDevice);
+  }
+
+  // Free the slot. Re-opening will get a new handle.
+  slot->device.reset();
+  slot->transferMutex.reset();
+  ++slot->generation;
+  freeDeviceSlots.push_back(deviceHandle % maxDeviceSlots);
+
+#ifdef __MEX_DEBUG_MODE
+  mexPrintf("Device closed\n");
+#endif
+}
+
+/**
+ * @brief Reads firmware and timestamp of a device, runs in a probe thread
+ *
+ * A device which is already open is read through its shared Device under its
+ * transfer mutex, otherwise the device is opened by its alias.
+ */
+void probeDevice(std::string deviceName, boost::shared_ptr<Device> openDevice,
+    std::shared_ptr<std::mutex> transferMutex, std::shared_ptr<DeviceProbe> probe) {
+  int firmware = 0, timestamp = 0;
+  bool valid = false;
+  try {
+    if(openDevice) {
+      std::lock_guard<std::mutex> lock(*transferMutex);
+      firmware = openDevice->read<int>("BOARD0/WORD_FIRMWARE");
+      timestamp = openDevice->read<int>("BOARD0/WORD_TIMESTAMP");
+    }
+    else {
+      Device device;
+      device.open(deviceName);
+      firmware = device.read<int>("BOARD0/WORD_FIRMWARE");
+      timestamp = device.read<int>("BOARD0/WORD_TIMESTAMP");
+    }
+    valid = true;
+  }
+  catch(...) {
+  }
+
+  std::lock_guard<std::mutex> lock(probe->mutex);
+  probe->firmware = firmware;
+  probe->timestamp = timestamp;
+  probe->valid = valid;
+  probe->done = true;
+  probe->doneTime = std::chrono::steady_clock::now();
+  probe->finished.notify_all();
+}
+
+/**
+ * @brief Joins the probe threads which have finished, unlocks the mex file after the last one
+ */
+void joinProbeThreads() {
+  for(auto it = probeThreads.begin(); it != probeThreads.end();) {
+    bool done;
+    {
+      std::lock_guard<std::mutex> lock(it->first->mutex);
+      done = it->first->done;
+    }
+    if(!done) {
+      ++it;
+      continue;
+    }
+    it->second.join();
+    it = probeThreads.erase(it);
+  }
+  if(probeThreads.empty() && probesLockMex) {
+    mexUnlock();
+    probesLockMex = false;
+  }
+}
+
+/**
+ * @brief getInfo
+ *
+ * Parameter: [timeout]
+ * All devices of the dmap file are probed concurrently. Devices which do not
+ * answer within the timeout in seconds (default 2) are reported with firmware
+ * 0 and picked up by a later call once their probe has finished. The results
+ * are cached until the dmap file is changed, failed probes are retried after
+ * 30 seconds at the earliest. Devices which are already open are read through
+ * their handle under the same timeout.
+ */
+void getInfo(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  static const unsigned int pp_timeout = 0;
+
+  if(nrhs > 1) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
+  if(ChimeraTK::getDMapFilePath().empty()) {
+    mexErrMsgTxt("DMapFilePath not set. Use mtca4u.setDMapFilePath to configure it.");
+  }
+
+  if((nrhs > pp_timeout) && (!mxIsRealScalar(prhs[pp_timeout]) || (mxGetScalar(prhs[pp_timeout]) < 0)))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_timeout + 1) + " input argument.");
+  const double timeout = (nrhs > pp_timeout) ? mxGetScalar(prhs[pp_timeout]) : defaultProbeTimeout;
+
+  joinProbeThreads();
+
+  const std::string dmapFilePath = ChimeraTK::getDMapFilePath();
+  struct stat dmapStat {};
+  stat(dmapFilePath.c_str(), &dmapStat);
+  if(!deviceInfoCache.dMap || (deviceInfoCache.dmapFilePath != dmapFilePath) ||
+      (deviceInfoCache.modificationTime.tv_sec != dmapStat.st_mtim.tv_sec) ||
+      (deviceInfoCache.modificationTime.tv_nsec != dmapStat.st_mtim.tv_nsec)) {
+    ChimeraTK::DMapFileParser dMapFileParser;
+    deviceInfoCache.dMap = dMapFileParser.parse(dmapFilePath);
+    deviceInfoCache.dmapFilePath = dmapFilePath;
+    deviceInfoCache.modificationTime = dmapStat.st_mtim;
+    deviceInfoCache.probes.clear();
+  }
+  auto& dMap = deviceInfoCache.dMap;
+
+  // Start the probes which are neither cached nor running
+  const auto now = std::chrono::steady_clock::now();
+  std::vector<std::shared_ptr<DeviceProbe>> probes;
+  for(auto deviceInfo = dMap->begin(); deviceInfo != dMap->end(); ++deviceInfo) {
+    auto& probe = deviceInfoCache.probes[deviceInfo->deviceName];
+    bool restart = !probe;
+    if(probe) {
+      std::lock_guard<std::mutex> lock(probe->mutex);
+      restart = probe->done && !probe->valid &&
+          (now - probe->doneTime > std::chrono::duration<double>(probeRetryInterval));
+    }
+    if(restart) {
+      probe = std::make_shared<DeviceProbe>();
+      boost::shared_ptr<Device> openDevice;
+      std::shared_ptr<std::mutex> transferMutex;
+      auto sharedDevice = sharedDevicesMap.find(DeviceName(dmapFilePath, deviceInfo->deviceName));
+      if(sharedDevice != sharedDevicesMap.end()) {
+        openDevice = sharedDevice->second.device;
+        transferMutex = sharedDevice->second.transferMutex;
+      }
+      if(!probesLockMex) {
+        mexLock();
+        probesLockMex = true;
+      }
+      probeThreads.emplace_back(
+          probe, std::thread(&probeDevice, deviceInfo->deviceName, openDevice, transferMutex, probe));
+    }
+    probes.push_back(probe);
+  }
+
+  mwSize dims[2] = {1, dMap->getSize()};
+  const char* field_names[] = {"name", "device", "firmware", "date", "map"};
+  plhs[0] = mxCreateStructArray(2, dims, (sizeof(field_names) / sizeof(*field_names)), field_names);
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeout);
+  unsigned int i = 0;
+
+  for(auto deviceInfo = dMap->begin(); deviceInfo != dMap->end(); ++deviceInfo, ++i) {
+    mxArray* firmware_value = mxCreateDoubleMatrix(1, 1, mxREAL);
+    *mxGetPr(firmware_value) = 0;
+
+    std::string date;
+
+    {
+      DeviceProbe& probe = *probes[i];
+      std::unique_lock<std::mutex> lock(probe.mutex);
+      probe.finished.wait_until(lock, deadline, [&] { return probe.done; });
+      if(probe.valid) {
+        *mxGetPr(firmware_value) = probe.firmware;
+        date = probe.timestamp;
+      }
+    }
+
+    mxSetFieldByNumber(plhs[0], i, 0, mxCreateString(deviceInfo->deviceName.c_str()));
+    mxSetFieldByNumber(plhs[0], i, 1, mxCreateString(deviceInfo->uri.c_str()));
+    mxSetFieldByNumber(plhs[0], i, 2, firmware_value);
+    mxSetFieldByNumber(plhs[0], i, 3, mxCreateString(date.c_str()));
+    mxSetFieldByNumber(plhs[0], i, 4, mxCreateString(deviceInfo->mapFileName.c_str()));
+  }
+}
+
+std::string getFundamentalTypeString(ChimeraTK::DataDescriptor::FundamentalType fundamentalType) {
+  if(fundamentalType == DataDescriptor::FundamentalType::numeric) return "numeric";
+  if(fundamentalType == DataDescriptor::FundamentalType::string) return "string";
+  if(fundamentalType == DataDescriptor::FundamentalType::boolean) return "boolean";
+  if(fundamentalType == DataDescriptor::FundamentalType::nodata) return "nodata";
+  if(fundamentalType == DataDescriptor::FundamentalType::undefined) return "undefined";
+  return "unknown";
+}
+
+/**
+ * @brief Returns the cached register catalogue of a device, reads it on first use
+ */
+const CachedRegisterCatalogue& getRegisterCatalogue(const mxArray* prhsDevice) {
+  boost::shared_ptr<Device> device = getDevice(prhsDevice);
+  const size_t deviceHandle = mxGetScalar(prhsDevice);
+
+  auto it = registerCataloguesMap.find(deviceHandle);
+  if(it != registerCataloguesMap.end()) return it->second;
+
+  CachedRegisterCatalogue catalogue;
+  auto registerCatalogue = device->getRegisterCatalogue();
+  for(auto cit = registerCatalogue.begin(); cit != registerCatalogue.end(); ++cit) {
+    catalogue.index[std::string(cit->getRegisterName())] = catalogue.registers.size();
+    catalogue.registers.push_back({std::string(cit->getRegisterName()), cit->getNumberOfElements(),
+        cit->getNumberOfChannels(), cit->getNumberOfDimensions(), cit->getDataDescriptor()});
+  }
+  return registerCataloguesMap[deviceHandle] = std::move(catalogue);
+}
+
+const CachedRegisterInfo& CachedRegisterCatalogue::getRegister(const RegisterPath& registerPath) const {
+  auto it = index.find(std::string(registerPath));
+  if(it == index.end()) mexErrMsgTxt("Register '" + std::string(registerPath) + "' not found.");
+  return registers[it->second];
+}
+
+/**
+ * @brief Returns the register catalogue as one struct with a Nx1 column per field
+ *
+ * The fields are name, nElementsPerChannel, nChannels, nDimensions,
+ * fundamentalType, isIntegral, isSigned and description, see getRegisterInfo.
+ */
+mxArray* getDeviceInfoColumns(const CachedRegisterCatalogue& registerCatalogue) {
+  const size_t nRegisters = registerCatalogue.registers.size();
+
+  const char* field_names[] = {"name", "nElementsPerChannel", "nChannels", "nDimensions", "fundamentalType",
+      "isIntegral", "isSigned", "description"};
+  mxArray* value = mxCreateStructMatrix(1, 1, (sizeof(field_names) / sizeof(*field_names)), field_names);
+
+  mxArray* names = mxCreateCellMatrix(nRegisters, 1);
+  mxArray* numElements = mxCreateDoubleMatrix(nRegisters, 1, mxREAL);
+  mxArray* numChannels = mxCreateDoubleMatrix(nRegisters, 1, mxREAL);
+  mxArray* numDimensions = mxCreateDoubleMatrix(nRegisters, 1, mxREAL);
+  mxArray* fundamentalTypes = mxCreateCellMatrix(nRegisters, 1);
+  mxArray* integralFlags = mxCreateLogicalMatrix(nRegisters, 1);
+  mxArray* signedFlags = mxCreateLogicalMatrix(nRegisters, 1);
+  mxArray* descriptions = mxCreateCellMatrix(nRegisters, 1);
+
+  for(size_t index = 0; index < nRegisters; ++index) {
+    const CachedRegisterInfo& registerInfo = registerCatalogue.registers[index];
+    mxSetCell(names, index, mxCreateString(registerInfo.name.c_str()));
+    mxGetPr(numElements)[index] = registerInfo.nElementsPerChannel;
+    mxGetPr(numChannels)[index] = registerInfo.nChannels;
+    mxGetPr(numDimensions)[index] = registerInfo.nDimensions;
+
+    auto fundamentalType = registerInfo.dataDescriptor.fundamentalType();
+    mxSetCell(fundamentalTypes, index, mxCreateString(getFundamentalTypeString(fundamentalType).c_str()));
+    if(fundamentalType == DataDescriptor::FundamentalType::numeric) {
+      mxGetLogicals(integralFlags)[index] = registerInfo.dataDescriptor.isIntegral();
+      mxGetLogicals(signedFlags)[index] = registerInfo.dataDescriptor.isSigned();
+    }
+    mxSetCell(descriptions, index, mxCreateString(""));
+  }
+
+  mxSetFieldByNumber(value, 0, 0, names);
+  mxSetFieldByNumber(value, 0, 1, numElements);
+  mxSetFieldByNumber(value, 0, 2, numChannels);
+  mxSetFieldByNumber(value, 0, 3, numDimensions);
+  mxSetFieldByNumber(value, 0, 4, fundamentalTypes);
+  mxSetFieldByNumber(value, 0, 5, integralFlags);
+  mxSetFieldByNumber(value, 0, 6, signedFlags);
+  mxSetFieldByNumber(value, 0, 7, descriptions);
+  return value;
+}
+
+/**
+ * @brief getDeviceInfo
+ *
+ * Parameter: device, [format]
+ * With format 'columns' one struct with a column per field is returned
+ * instead of a struct per register, see getDeviceInfoColumns.
+ */
+void getDeviceInfo(unsigned int nlhs, mxArray** plhs, unsigned int nrhs, const mxArray* prhs[]) {
+  static const unsigned int pp_device = 0, pp_format = 1;
+
+  if(nrhs < 1) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 2) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
+
+  const CachedRegisterCatalogue& registerCatalogue = getRegisterCatalogue(prhs[pp_device]);
+
+  if(nrhs > pp_format) {
+    if(!mxIsChar(prhs[pp_format]) || (mxArrayToStdString(prhs[pp_format]) != "columns"))
+      mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_format) + " input argument.");
+    plhs[0] = getDeviceInfoColumns(registerCatalogue);
+    return;
+  }
 
   //                    index: 0       1            2            3 4 5
   const char* field_names[] = {
       "name", "nElementsPerChannel", "nChannels", "nDimensions", "fundamentalType", "description"};
 
-  plhs[0] = mxCreateStructMatrix(
-      registerCatalogue.getNumberOfRegisters(), 1, (sizeof(field_names) / sizeof(*field_names)), field_names);
+  plhs[0] = mxCreateStructMatrix(
+      registerCatalogue.registers.size(), 1, (sizeof(field_names) / sizeof(*field_names)), field_names);
+
+  unsigned int index = 0;
+  for(auto cit = registerCatalogue.registers.begin(); cit != registerCatalogue.registers.end(); ++cit, ++index) {
+    mxSetFieldByNumber(plhs[0], index, 0, mxCreateString(cit->name.c_str()));
+
+    mxArray* numElements = mxCreateDoubleMatrix(1, 1, mxREAL);
+    *mxGetPr(numElements) = cit->nElementsPerChannel;
+    mxSetFieldByNumber(plhs[0], index, 1, numElements);
+
+    mxArray* numChannels = mxCreateDoubleMatrix(1, 1, mxREAL);
+    *mxGetPr(numChannels) = cit->nChannels;
+    mxSetFieldByNumber(plhs[0], index, 2, numChannels);
+
+    mxArray* numDimensions = mxCreateDoubleMatrix(1, 1, mxREAL);
+    *mxGetPr(numDimensions) = cit->nDimensions;
+    mxSetFieldByNumber(plhs[0], index, 3, numDimensions);
+
+    auto fundamentalType = cit->dataDescriptor.fundamentalType();
+    mxSetFieldByNumber(plhs[0], index, 4, mxCreateString(getFundamentalTypeString(fundamentalType).c_str()));
+
+    mxSetFieldByNumber(plhs[0], index, 5, mxCreateString(""));
+  }
+}
+
+/**
+ * @brief getRegisterInfo
+ *
+ */
+void getRegisterInfo(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  if(nrhs < 3) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 3) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
+
+  if(!mxIsChar(prhs[1])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(2) + " input argument.");
+  if(!mxIsChar(prhs[2])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(3) + " input argument.");
+
+  const CachedRegisterCatalogue& registerCatalogue = getRegisterCatalogue(prhs[0]);
+
+  RegisterPath moduleName(mxArrayToStdString(prhs[1]));
+  RegisterPath registerName(mxArrayToStdString(prhs[2]));
+  const CachedRegisterInfo& registerInfo = registerCatalogue.getRegister(moduleName / registerName);
+  auto& dataDescriptor = registerInfo.dataDescriptor;
+
+  //                    index: 0       1                      2            3 4
+  //                    5              6          7
+  const char* field_names[] = {"name", "nElementsPerChannel", "nChannels", "nDimensions", "fundamentalType",
+      "isIntegral", "isSigned", "description"};
+  plhs[0] = mxCreateStructMatrix(1, 1, (sizeof(field_names) / sizeof(*field_names)), field_names);
+
+  mxSetFieldByNumber(plhs[0], 0, 0, mxCreateString(registerInfo.name.c_str()));
+
+  mxArray* numElements = mxCreateDoubleMatrix(1, 1, mxREAL);
+  *mxGetPr(numElements) = registerInfo.nElementsPerChannel;
+  mxSetFieldByNumber(plhs[0], 0, 1, numElements);
+
+  mxArray* numChannels = mxCreateDoubleMatrix(1, 1, mxREAL);
+  *mxGetPr(numChannels) = registerInfo.nChannels;
+  mxSetFieldByNumber(plhs[0], 0, 2, numChannels);
+
+  mxArray* numDimensions = mxCreateDoubleMatrix(1, 1, mxREAL);
+  *mxGetPr(numDimensions) = registerInfo.nDimensions;
+  mxSetFieldByNumber(plhs[0], 0, 3, numDimensions);
+
+  auto fundamentalType = dataDescriptor.fundamentalType();
+
+  mxSetFieldByNumber(plhs[0], 0, 4, mxCreateString(getFundamentalTypeString(fundamentalType).c_str()));
+
+  bool isIntegral = false; // default value in case the data type is not numeric
+  bool isSigned = false;   // default value in case the data type is not numeric
+  if(fundamentalType == DataDescriptor::FundamentalType::numeric) {
+    // These operations on the data descriptor are only valid for numeric types.
+    // They will throw otherwise.
+    isIntegral = dataDescriptor.isIntegral();
+    isSigned = dataDescriptor.isSigned();
+  }
+
+  mxArray* integralFlag = mxCreateLogicalMatrix(1, 1);
+  *mxGetPr(integralFlag) = isIntegral;
+  mxSetFieldByNumber(plhs[0], 0, 5, integralFlag);
+
+  mxArray* signedFlag = mxCreateLogicalMatrix(1, 1);
+  *mxGetPr(signedFlag) = isSigned;
+  mxSetFieldByNumber(plhs[0], 0, 6, signedFlag);
+
+  mxSetFieldByNumber(plhs[0], 0, 7, mxCreateString(""));
+}
+
+/**
+ * @brief getRegisterSize
+ *
+ */
+void getRegisterSize(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  if(nrhs < 3) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 3) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
+
+  const CachedRegisterCatalogue& registerCatalogue = getRegisterCatalogue(prhs[0]);
+
+  if(!mxIsChar(prhs[1])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(1) + " input argument.");
+  if(!mxIsChar(prhs[2])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(2) + " input argument.");
+
+  RegisterPath moduleName(mxArrayToStdString(prhs[1]));
+  RegisterPath registerName(mxArrayToStdString(prhs[2]));
+
+  plhs[0] = mxCreateDoubleMatrix(1, 1, mxREAL);
+  (*mxGetPr(plhs[0])) = registerCatalogue.getRegister(moduleName / registerName).nElementsPerChannel;
+}
+
+/**
+ * @brief Reads a register as UserType into a new 1xN Matlab array of class TargetType
+ *
+ * The Matlab array is allocated once and filled from the accessor buffer by
+ * copyFnc(source, destination, nElements). If a chunk size is set and the
+ * register is larger, it is read in windows of that size, so the extra memory
+ * needed is independent of the register size.
+ * Notice that the windows are separate transfers. Their accessors are kept
+ * for the next chunked read of the same register, see ChunkAccessors.
+ */
+template<typename UserType, typename TargetType, typename CopyFnc>
+mxArray* readToMxArray(Device& device, const RegisterPath& registerPath, uint32_t nElements, uint32_t offset,
+    const AccessModeFlags& flags, CopyFnc copyFnc) {
+  const ChunkAccessorsKey key(&device, registerPath, offset, nElements, readChunkSize, flags.has(AccessMode::raw));
+  auto* chunks = dynamic_cast<ChunkAccessorsImpl<UserType>*>(chunkAccessors.get());
+  if(chunks && (chunkAccessorsKey != key)) chunks = NULL;
+
+  size_t totalElements = nElements;
+  if(!chunks && (readChunkSize > 0) && (totalElements == 0)) {
+    const size_t registerElements = device.getRegisterCatalogue().getRegister(registerPath).getNumberOfElements();
+    // An invalid offset is reported by the accessor below
+    if(offset < registerElements) totalElements = registerElements - offset;
+  }
+
+  if(!chunks && (readChunkSize > 0) && (totalElements > readChunkSize)) {
+    statistics.phase(phaseSetup);
+    // Release the buffers of the previous register before creating the new ones
+    chunkAccessors.reset();
+    std::unique_ptr<ChunkAccessorsImpl<UserType>> created(new ChunkAccessorsImpl<UserType>);
+    for(size_t done = 0; done < totalElements; done += readChunkSize) {
+      created->accessors.push_back(device.getOneDRegisterAccessor<UserType>(
+          registerPath, std::min(readChunkSize, totalElements - done), offset + done, flags));
+    }
+    chunks = created.get();
+    chunkAccessors = std::move(created);
+    chunkAccessorsKey = key;
+  }
+
+  if(chunks) {
+    totalElements = 0;
+    for(auto& accessor : chunks->accessors) totalElements += accessor.getNElements();
+    mxArray* value = mxCreateUninitNumericMatrix(1, totalElements, getMxClassID<TargetType>(), mxREAL);
+    TargetType* data = static_cast<TargetType*>(mxGetData(value));
+
+    size_t done = 0;
+    for(auto& accessor : chunks->accessors) {
+      statistics.phase(phaseTransfer);
+      accessor.read();
+      statistics.phase(phaseConversion);
+      copyFnc(accessor.data(), data + done, accessor.getNElements());
+      statistics.addBytes(registerPath, accessor.getNElements() * sizeof(UserType));
+      done += accessor.getNElements();
+    }
+    return value;
+  }
+
+  statistics.phase(phaseSetup);
+  auto accessor = device.getOneDRegisterAccessor<UserType>(registerPath, nElements, offset, flags);
+  statistics.phase(phaseTransfer);
+  accessor.read();
+  statistics.phase(phaseConversion);
+
+  mxArray* value = mxCreateUninitNumericMatrix(1, accessor.getNElements(), getMxClassID<TargetType>(), mxREAL);
+  copyFnc(accessor.data(), static_cast<TargetType*>(mxGetData(value)), accessor.getNElements());
+  statistics.addBytes(registerPath, accessor.getNElements() * sizeof(UserType));
+  return value;
+}
+
+/**
+ * @brief Reads a register as UserType into a new 1xN Matlab array of the matching class
+ */
+template<typename UserType>
+mxArray* readToMxArray(Device& device, const RegisterPath& registerPath, uint32_t nElements, uint32_t offset,
+    const AccessModeFlags& flags = AccessModeFlags({})) {
+  // as both DeviceAccess and Matlab do their own memory allocation all we can
+  // do is memcpy :-(
+  return readToMxArray<UserType, UserType>(device, registerPath, nElements, offset, flags,
+      [](const UserType* source, UserType* destination, size_t n) { memcpy(destination, source, n * sizeof(UserType)); });
+}
+
+/**
+ * @brief Reads a register in one transfer and returns only the reduced data as row, see reduceToMxArray
+ *
+ * The reduction runs directly on the accessor buffer, unless convertFnc has
+ * to convert the data into TargetType first. The chunk size is not applied.
+ */
+template<typename UserType, typename TargetType = UserType>
+mxArray* readReducedToMxArray(Device& device, const RegisterPath& registerPath, uint32_t nElements, uint32_t offset,
+    const AccessModeFlags& flags, const Reduction& reduction,
+    std::function<void(const UserType*, TargetType*, size_t)> convertFnc = nullptr) {
+  statistics.phase(phaseSetup);
+  auto accessor = device.getOneDRegisterAccessor<UserType>(registerPath, nElements, offset, flags);
+  statistics.phase(phaseTransfer);
+  accessor.read();
+  statistics.phase(phaseConversion);
+  statistics.addBytes(registerPath, accessor.getNElements() * sizeof(UserType));
+
+  if(!convertFnc) {
+    const TargetType* data = reinterpret_cast<const TargetType*>(accessor.data());
+    return reduceToMxArray<TargetType>(reduction, {data}, accessor.getNElements(), true);
+  }
+  std::vector<TargetType> converted(accessor.getNElements());
+  convertFnc(accessor.data(), converted.data(), converted.size());
+  return reduceToMxArray<TargetType>(reduction, {converted.data()}, converted.size(), true);
+}
+
+/**
+ * @brief setReadChunkSize
+ *
+ * Parameter: maximum number of elements per transfer in read and read_raw, 0 = no limit
+ */
+void setReadChunkSize(unsigned int, mxArray**, unsigned int nrhs, const mxArray* prhs[]) {
+  if(nrhs < 1) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 1) mexWarnMsgTxt("Too many input arguments.");
+
+  if(!mxIsRealScalar(prhs[0]) || (mxGetScalar(prhs[0]) < 0))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(1) + " input argument.");
+
+  readChunkSize = mxGetScalar(prhs[0]);
+  chunkAccessors.reset();
+}
+
+void getReadChunkSize(unsigned int, mxArray* plhs[], unsigned int, const mxArray**) {
+  plhs[0] = mxCreateDoubleMatrix(1, 1, mxREAL);
+  (*mxGetPr(plhs[0])) = readChunkSize;
+}
+
+/**
+ * @brief readRegister
+ *
+ * Parameter: device, module, register, [offset], [elements], [class], [reduction]
+ * class is the Matlab class of the output ('double' by default, 'single',
+ * 'int8' ... 'uint64' or 'native'). It may also directly follow the register.
+ * reduction is a cell {kind, parameter}, see parseReduction.
+ */
+void readRegister(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  static const unsigned int pp_device = 0, pp_module = 1, pp_register = 2, pp_offset = 3, pp_elements = 4;
+
+  if(nrhs < 3) mexErrMsgTxt("Not enough input arguments.");
+
+  // the reduction and the output class are always the last arguments
+  Reduction reduction;
+  if((nrhs > pp_offset) && mxIsCell(prhs[nrhs - 1])) reduction = parseReduction(prhs[--nrhs]);
+  const mxArray* prhsClass = NULL;
+  if((nrhs > pp_offset) && mxIsChar(prhs[nrhs - 1])) prhsClass = prhs[--nrhs];
+
+  if(nrhs > 5) mexWarnMsgTxt("To many input arguments.");
+  if(nlhs > 1) mexErrMsgTxt("To many output arguments.");
+
+  boost::shared_ptr<Device> device = getDevice(prhs[pp_device]);
+
+  if(!mxIsChar(prhs[pp_module])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_module) + " input argument.");
+  if(!mxIsChar(prhs[pp_register])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_register) + " input argument.");
+
+  if((nrhs > pp_offset) && (!mxIsRealScalar(prhs[pp_offset]) || (mxGetScalar(prhs[pp_offset]) < 0)))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_offset) + " input argument.");
+
+  if((nrhs > pp_elements) && !mxIsPositiveRealScalar(prhs[pp_elements]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_elements) + " input argument.");
+
+  // offset is optional. Use 0 if not set
+  const uint32_t offset = (nrhs > pp_offset) ? mxGetScalar(prhs[pp_offset]) : 0;
+
+  // number of elements is optional. Use 0 (=all remaining) if not set
+  const uint32_t nElements = (nrhs > pp_elements) ? mxGetScalar(prhs[pp_elements]) : 0;
+
+  RegisterPath moduleName(mxArrayToStdString(prhs[pp_module]));
+  RegisterPath registerName(mxArrayToStdString(prhs[pp_register]));
+  RegisterPath registerPath = moduleName / registerName;
+
+  const mxClassID outputClass = prhsClass ? getOutputMxClassID(prhsClass, *device, registerPath) : mxDOUBLE_CLASS;
+
+  callForMxClass(outputClass, [&](auto v) {
+    typedef decltype(v) UserType;
+    if(reduction.kind != Reduction::none)
+      plhs[0] = readReducedToMxArray<UserType>(*device, registerPath, nElements, offset, {}, reduction);
+    else
+      plhs[0] = readToMxArray<UserType>(*device, registerPath, nElements, offset);
+  });
+}
+
+/**
+ * @brief writeRegister
+ *
+ * Parameter: device, module, register, value, [offset]
+ */
+void writeRegister(unsigned int, mxArray**, unsigned int nrhs, const mxArray* prhs[]) {
+  static const unsigned int pp_device = 0, pp_module = 1, pp_register = 2, pp_value = 3, pp_offset = 4;
+
+  if(nrhs < 4) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 5) mexWarnMsgTxt("To many input arguments.");
+
+  boost::shared_ptr<Device> device = getDevice(prhs[pp_device]);
+
+  if(!mxIsChar(prhs[pp_module])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_module) + " input argument.");
+  if(!mxIsChar(prhs[pp_register])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_register) + " input argument.");
+
+  if((!mxIsNumeric(prhs[pp_value]) && !mxIsLogical(prhs[pp_value])) || mxIsComplex(prhs[pp_value]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_value) + " input argument.");
+
+  if((nrhs > pp_offset) && (!mxIsRealScalar(prhs[pp_offset]) || (mxGetScalar(prhs[pp_offset]) < 0)))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_offset) + " input argument.");
+
+  const uint32_t offset = (nrhs > pp_offset) ? mxGetScalar(prhs[pp_offset]) : 0;
+  RegisterPath registerPath(mxArrayToStdString(prhs[pp_module]) + "/" + mxArrayToStdString(prhs[pp_register]));
+
+  WriteFnc writeFnc = getWriteFunction(mxGetClassID(prhs[pp_value]));
+  if(!writeFnc) mexErrMsgTxt("Data type unsupported.");
+  writeFnc(*device, registerPath, prhs[pp_value], offset);
+}
+
+/**
+ * @brief readRawDmaData
+ *
+ * Parameter: device, module, register, [offset], [elements], [mode], [singed],
+ * [bit], [fracbit]
+ */
+void readDmaRaw(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  static const unsigned int pp_device = 0, pp_module = 1, pp_register = 2, pp_offset = 3, pp_elements = 4;
+  static const unsigned int pp_mode = 5, pp_signed = 6; // followed by bit, fracbit
+
+  if(nrhs < 3) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 9) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
+
+  boost::shared_ptr<Device> device = getDevice(prhs[pp_device]);
+
+  if(!mxIsChar(prhs[pp_module])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_module) + " input argument.");
+  if(!mxIsChar(prhs[pp_register])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_register) + " input argument.");
+
+  if((nrhs > pp_offset) && !mxIsRealScalar(prhs[pp_offset]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_offset) + " input argument.");
+  if((nrhs > pp_elements) && !mxIsPositiveRealScalar(prhs[pp_elements]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_elements) + " input argument.");
+
+  if((nrhs > pp_mode) && !mxIsPositiveRealScalar(prhs[pp_mode]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_mode) + " input argument.");
+
+  // offset is optional. Use 0 if not set
+  const uint32_t offset = (nrhs > pp_offset) ? mxGetScalar(prhs[pp_offset]) : 0;
+  // number of elements is optional. Use 0 (=all remaining) if not set
+  const uint32_t nElements = (nrhs > pp_elements) ? mxGetScalar(prhs[pp_elements]) : 0;
+
+  // The mode can be 16 or 32 bit. This does not make sense because the real raw
+  // stuff is 32 bits, it was there so we keep it in order not to break
+  // compatibility.
+  const uint32_t mode = (nrhs > pp_mode) ? mxGetScalar(prhs[pp_mode]) : 32;
+  if((mode != 32) && (mode != 16)) mexErrMsgTxt("Invalid data mode.");
+
+  // signed, bit and fracbit select a fixed point conversion of the raw
+  // words. Without them the raw values are returned, as before.
+  const bool convert = (nrhs > pp_signed);
+  FixedPointFormat format{false, mode, 0};
+  if(convert) format = parseFixedPointFormat(nrhs, prhs, pp_signed, mode);
+
+  // Number of 32 bit words to read through the "bus". This currently is the
+  // only mode the raw accessor knows
+  uint32_t nWords32Bit = nElements;
+  if(mode == 16) {
+    // The number of 32 bit words is only half the number of elements if the are
+    // requested as 16 bit
+    nWords32Bit /= 2;
+  }
+
+  // Now that we have all parameters it's time to read the data from the device.
+  RegisterPath registerPath(mxArrayToStdString(prhs[pp_module]) + "/" + mxArrayToStdString(prhs[pp_register]));
+
+  // we get the register content as a std::vector<double>
+  statistics.phase(phaseSetup);
+  auto accessor = device->getOneDRegisterAccessor<int32_t>(registerPath, nWords32Bit, offset, {AccessMode::raw});
+  statistics.phase(phaseTransfer);
+  accessor.read();
+  statistics.phase(phaseConversion);
+  statistics.addBytes(registerPath, accessor.getNElements() * sizeof(int32_t));
+
+  // frame matlab buffer with appropriate number of elements
+  auto bufferSize = (mode == 16) ? accessor.getNElements() * 2 : accessor.getNElements();
+  plhs[0] = mxCreateUninitNumericMatrix(bufferSize, 1, mxDOUBLE_CLASS, mxREAL);
+
+  double* plhsValue = mxGetPr(plhs[0]);
+
+  if(convert && (mode == 32)) {
+    rawToFixedPoint(accessor.data(), plhsValue, bufferSize, format);
+  }
+  else if(convert) {
+    rawToFixedPoint(reinterpret_cast<int16_t*>(accessor.data()), plhsValue, bufferSize, format);
+  }
+  else if(mode == 32) {
+    size_t i = 0;
+    // we can directly loop the accessor
+    for(auto value : accessor) {
+      plhsValue[i++] = value;
+    }
+  }
+  else {
+    auto values16Bit = reinterpret_cast<int16_t*>(accessor.data());
+    for(size_t i = 0; i < bufferSize; ++i) {
+      plhsValue[i] = values16Bit[i];
+    }
+  }
+}
+
+/**
+ * @brief Reads selected sequences of a 2D register as UserType, see readSequence
+ *
+ * Only the window [offset, offset + elements) of each channel is converted by
+ * the accessor. Each selected channel is copied as one block into a column of
+ * the output.
+ *
+ * @param[in] channels Zero based channel indices, all channels if empty
+ * @param[in] elements Number of elements per channel, 0 = all after offset
+ */
+template<typename UserType>
+void readSequenceToMxArray(unsigned int nlhs, mxArray* plhs[], std::vector<size_t> channels, uint32_t offset,
+    uint32_t elements, Device& device, const RegisterPath& registerPath, const Reduction& reduction) {
+  statistics.phase(phaseSetup);
+  auto twoDRegister = device.getTwoDRegisterAccessor<UserType>(registerPath, elements, offset);
+
+  const size_t totalChannels = twoDRegister.getNChannels();
+  const size_t nElements = twoDRegister.getNElementsPerChannel();
+
+  if(channels.empty()) {
+    for(size_t ic = 0; ic < totalChannels; ++ic) channels.push_back(ic);
+  }
+  for(auto channel : channels) {
+    if(channel >= totalChannels) mexErrMsgTxt("Illegal Channel Index");
+  }
+
+  statistics.phase(phaseTransfer);
+  twoDRegister.read();
+  statistics.phase(phaseConversion);
+
+  const size_t nBytes = nElements * sizeof(UserType);
+  statistics.addBytes(registerPath, nBytes * channels.size());
+
+  // Reduce each channel directly from the accessor buffer
+  if(reduction.kind != Reduction::none) {
+    std::vector<const UserType*> columns;
+    for(auto channel : channels) columns.push_back(twoDRegister[channel].data());
+    if(nlhs == channels.size()) {
+      for(size_t ic = 0; ic < channels.size(); ic++)
+        plhs[ic] = reduceToMxArray<UserType>(reduction, {columns[ic]}, nElements, false);
+    }
+    else {
+      plhs[0] = reduceToMxArray<UserType>(reduction, columns, nElements, false);
+    }
+    return;
+  }
+
+  // Store data in different vectors passed over lhs
+  if(nlhs == channels.size()) {
+    for(size_t ic = 0; ic < channels.size(); ic++) {
+      plhs[ic] = mxCreateUninitNumericMatrix(nElements, 1, getMxClassID<UserType>(), mxREAL);
+      memcpy(mxGetData(plhs[ic]), twoDRegister[channels[ic]].data(), nBytes);
+    }
+  }
+  // Store data in lhs matrix, Matlab is column major so each channel is a contiguous column
+  else {
+    plhs[0] = mxCreateUninitNumericMatrix(nElements, channels.size(), getMxClassID<UserType>(), mxREAL);
+    char* plhsValue = static_cast<char*>(mxGetData(plhs[0]));
+    for(size_t ic = 0; ic < channels.size(); ic++) {
+      memcpy(plhsValue + ic * nBytes, twoDRegister[channels[ic]].data(), nBytes);
+    }
+  }
+}
+
+/**
+ * @brief readSequence
+ *
+ * Parameter: device, module, register, [channel], [offset], [elements], [class], [reduction]
+ * class is the Matlab class of the output and reduction is applied to each
+ * channel, see readRegister.
+ */
+void readSequence(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  static const unsigned int pp_device = 0, pp_module = 1, pp_register = 2, pp_channel = 3, pp_offset = 4,
+                            pp_elements = 5;
+
+  if(nrhs < 3) mexErrMsgTxt("Not enough input arguments.");
+
+  // the reduction and the output class are always the last arguments
+  Reduction reduction;
+  if((nrhs > pp_channel) && mxIsCell(prhs[nrhs - 1])) reduction = parseReduction(prhs[--nrhs]);
+  const mxArray* prhsClass = NULL;
+  if((nrhs > pp_channel) && mxIsChar(prhs[nrhs - 1])) prhsClass = prhs[--nrhs];
+  if(nrhs > 6) mexWarnMsgTxt("Too many input arguments.");
+
+  boost::shared_ptr<Device> device = getDevice(prhs[pp_device]);
+
+  if(!mxIsChar(prhs[pp_module])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_module) + " input argument.");
+  if(!mxIsChar(prhs[pp_register])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_register) + " input argument.");
+
+  if((nrhs > pp_channel) && !mxIsPositiveRealVector(prhs[pp_channel]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_channel) + " input argument.");
+
+  if((nlhs > 1) && !(nrhs > pp_channel)) mexErrMsgTxt("Not enough input arguments.");
+  if((nlhs > 1) && (nrhs > pp_channel) && (nlhs > mxGetNumberOfElements(prhs[pp_channel])))
+    mexErrMsgTxt("Too many output arguments.");
+  if((nlhs > 1) && (nrhs > pp_channel) && (nlhs < mxGetNumberOfElements(prhs[pp_channel])))
+    mexErrMsgTxt("Not enough output arguments.");
+
+  if((nrhs > pp_offset) && (!mxIsRealScalar(prhs[pp_offset]) || (mxGetScalar(prhs[pp_offset]) < 0)))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_offset) + " input argument.");
+  if((nrhs > pp_elements) && !mxIsPositiveRealScalar(prhs[pp_elements]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_elements) + " input argument.");
+
+  // Channels are one based in Matlab
+  std::vector<size_t> channels;
+  if(nrhs > pp_channel) {
+    std::vector<double> channelIndices(mxGetNumberOfElements(prhs[pp_channel]));
+    copyFromMxArray(prhs[pp_channel], channelIndices.data(), channelIndices.size());
+    for(auto channel : channelIndices) {
+      if((channel < 1) || (channel != std::floor(channel))) mexErrMsgTxt("Illegal Channel Index");
+      channels.push_back(size_t(channel) - 1);
+    }
+  }
+
+  const uint32_t offset = (nrhs > pp_offset) ? mxGetScalar(prhs[pp_offset]) : 0;
+  // number of elements is optional. Use 0 (=all after the offset) if not set
+  const uint32_t elements = (nrhs > pp_elements) ? mxGetScalar(prhs[pp_elements]) : 0;
+
+  RegisterPath registerPath(mxArrayToStdString(prhs[pp_module]) + "/" + mxArrayToStdString(prhs[pp_register]));
+  const mxClassID outputClass = prhsClass ? getOutputMxClassID(prhsClass, *device, registerPath) : mxDOUBLE_CLASS;
+
+  callForMxClass(outputClass, [&](auto v) {
+    typedef decltype(v) UserType;
+    readSequenceToMxArray<UserType>(nlhs, plhs, channels, offset, elements, *device, registerPath, reduction);
+  });
+}
+
+/**
+ * @brief readRaw
+ *
+ * Parameter: device, module, register, [offset], [elements], [signed], [bit], [fracbit], [class], [reduction]
+ * Without fixed point format the raw words are returned as int32. With a
+ * format they are converted while copying into a 'double' (default) or
+ * 'single' array, see rawToFixedPoint. reduction is applied to the raw words
+ * or the fixed point values, see readRegister.
+ */
+void readRaw(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  static const unsigned int pp_device = 0, pp_module = 1, pp_register = 2, pp_offset = 3, pp_elements = 4,
+                            pp_signed = 5;
+
+  if(nrhs < 3) mexErrMsgTxt("Not enough input arguments.");
+
+  // the reduction and the output class are always the last arguments
+  Reduction reduction;
+  if((nrhs > pp_offset) && mxIsCell(prhs[nrhs - 1])) reduction = parseReduction(prhs[--nrhs]);
+  const mxArray* prhsClass = NULL;
+  if((nrhs > pp_offset) && mxIsChar(prhs[nrhs - 1])) prhsClass = prhs[--nrhs];
+  if(nrhs > 8) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
+
+  auto device = getDevice(prhs[pp_device]);
+
+  if(!mxIsChar(prhs[pp_module])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_module) + " input argument.");
+  if(!mxIsChar(prhs[pp_register])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_register) + " input argument.");
+
+  if((nrhs > pp_offset) && !mxIsRealScalar(prhs[pp_offset])) {
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_offset) + " input argument.");
+  }
+  if((nrhs > pp_elements) && !mxIsPositiveRealScalar(prhs[pp_elements])) {
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_elements) + " input argument.");
+  }
+
+  // offset, nElements is optional. Use 0 if not set; nElements = 0 =>
+  // read all elements.
+  const uint32_t offset = (nrhs > pp_offset) ? mxGetScalar(prhs[pp_offset]) : 0;
+  const uint32_t nElements = (nrhs > pp_elements) ? mxGetScalar(prhs[pp_elements]) : 0;
+
+  RegisterPath registerPath(mxArrayToStdString(prhs[pp_module]) + "/" + mxArrayToStdString(prhs[pp_register]));
+
+  if(nrhs <= pp_signed) {
+    if(prhsClass) mexErrMsgTxt("The output class of read_raw needs a fixed point format.");
+    if(reduction.kind != Reduction::none)
+      plhs[0] = readReducedToMxArray<int32_t>(*device, registerPath, nElements, offset, {AccessMode::raw}, reduction);
+    else
+      plhs[0] = readToMxArray<int32_t>(*device, registerPath, nElements, offset, {AccessMode::raw});
+    return;
+  }
+
+  const FixedPointFormat format = parseFixedPointFormat(nrhs, prhs, pp_signed, 32);
+  const mxClassID outputClass = prhsClass ? getOutputMxClassID(prhsClass, *device, registerPath) : mxDOUBLE_CLASS;
+  if((outputClass != mxDOUBLE_CLASS) && (outputClass != mxSINGLE_CLASS))
+    mexErrMsgTxt("Fixed point values can only be read as 'double' or 'single'.");
+
+  callForMxClass(outputClass, [&](auto v) {
+    typedef decltype(v) UserType;
+    auto convertFnc = [&](const int32_t* raw, UserType* destination, size_t n) {
+      rawToFixedPoint(raw, destination, n, format);
+    };
+    if(reduction.kind != Reduction::none)
+      plhs[0] = readReducedToMxArray<int32_t, UserType>(
+          *device, registerPath, nElements, offset, {AccessMode::raw}, reduction, convertFnc);
+    else
+      plhs[0] = readToMxArray<int32_t, UserType>(*device, registerPath, nElements, offset, {AccessMode::raw}, convertFnc);
+  });
+}
+
+/**
+ * @brief resolveRegister
+ *
+ * Creates (or reuses) a cached accessor and returns its handle for read_h and
+ * write_h.
+ *
+ * Parameter: device, module, register, [offset], [elements], [type]
+ * type is 'double' (default) or 'raw'
+ */
+void resolveRegister(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  static const unsigned int pp_device = 0, pp_module = 1, pp_register = 2, pp_offset = 3, pp_elements = 4,
+                            pp_type = 5;
+
+  if(nrhs < 3) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 6) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
+
+  boost::shared_ptr<Device> device = getDevice(prhs[pp_device]);
+  const size_t deviceHandle = mxGetScalar(prhs[pp_device]);
+
+  if(!mxIsChar(prhs[pp_module])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_module) + " input argument.");
+  if(!mxIsChar(prhs[pp_register])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_register) + " input argument.");
+
+  if((nrhs > pp_offset) && (!mxIsRealScalar(prhs[pp_offset]) || (mxGetScalar(prhs[pp_offset]) < 0)))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_offset) + " input argument.");
+  if((nrhs > pp_elements) && (!mxIsRealScalar(prhs[pp_elements]) || (mxGetScalar(prhs[pp_elements]) < 0)))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_elements) + " input argument.");
+  if((nrhs > pp_type) && !mxIsChar(prhs[pp_type]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_type) + " input argument.");
+
+  const uint32_t offset = (nrhs > pp_offset) ? mxGetScalar(prhs[pp_offset]) : 0;
+  // number of elements is optional. Use 0 (=all remaining) if not set
+  const uint32_t nElements = (nrhs > pp_elements) ? mxGetScalar(prhs[pp_elements]) : 0;
+  const std::string type = (nrhs > pp_type) ? mxArrayToStdString(prhs[pp_type]) : "double";
+
+  RegisterPath registerPath(mxArrayToStdString(prhs[pp_module]) + "/" + mxArrayToStdString(prhs[pp_register]));
+  RegisterHandleKey key(deviceHandle, registerPath, offset, nElements, type);
+
+  auto it = registerHandlesMap.find(key);
+  if(it == registerHandlesMap.end()) {
+    std::unique_ptr<RegisterHandle> handle;
+    if(type == "double") {
+      handle.reset(new RegisterHandleImpl<double>(
+          deviceHandle, device->getOneDRegisterAccessor<double>(registerPath, nElements, offset)));
+    }
+    else if(type == "raw") {
+      handle.reset(new RegisterHandleImpl<int32_t>(
+          deviceHandle, device->getOneDRegisterAccessor<int32_t>(registerPath, nElements, offset, {AccessMode::raw})));
+    }
+    else {
+      mexErrMsgTxt("Unknown register type '" + type + "'.");
+    }
+    size_t slotIndex;
+    if(!freeRegisterHandleSlots.empty()) {
+      slotIndex = freeRegisterHandleSlots.back();
+      freeRegisterHandleSlots.pop_back();
+    }
+    else {
+      if(registerHandleSlotsVector.size() >= maxRegisterHandleSlots) mexErrMsgTxt("Too many register handles.");
+      slotIndex = registerHandleSlotsVector.size();
+      registerHandleSlotsVector.emplace_back();
+    }
+    RegisterHandleSlot& slot = registerHandleSlotsVector[slotIndex];
+    slot.handle = std::move(handle);
+    it = registerHandlesMap.emplace(key, slotIndex + slot.generation * maxRegisterHandleSlots).first;
+  }
+
+  plhs[0] = mxCreateDoubleMatrix(1, 1, mxREAL);
+  (*mxGetPr(plhs[0])) = it->second;
+}
+
+RegisterHandle& getRegisterHandle(const mxArray* prhsHandle) {
+  if(!mxIsRealScalar(prhsHandle)) mexErrMsgTxt("Invalid register handle.");
+
+  if(mxGetScalar(prhsHandle) < 0) mexErrMsgTxt("Invalid register handle.");
+  const size_t registerHandle = mxGetScalar(prhsHandle);
+
+  if(registerHandle % maxRegisterHandleSlots >= registerHandleSlotsVector.size())
+    mexErrMsgTxt("Invalid register handle.");
+
+  RegisterHandleSlot& slot = registerHandleSlotsVector[registerHandle % maxRegisterHandleSlots];
+  if(!slot.handle || (slot.generation != registerHandle / maxRegisterHandleSlots))
+    mexErrMsgTxt("Register handle released.");
+
+  return *slot.handle;
+}
+
+void releaseRegisterHandles(size_t deviceHandle) {
+  for(auto it = registerHandlesMap.begin(); it != registerHandlesMap.end();) {
+    if(std::get<0>(it->first) == deviceHandle) {
+      // Free the slot. Resolving again will get a new handle.
+      RegisterHandleSlot& slot = registerHandleSlotsVector[it->second % maxRegisterHandleSlots];
+      slot.handle.reset();
+      ++slot.generation;
+      freeRegisterHandleSlots.push_back(it->second % maxRegisterHandleSlots);
+      it = registerHandlesMap.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+}
+
+/**
+ * @brief readRegisterHandle
+ *
+ * Parameter: register handle
+ */
+void readRegisterHandle(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  if(nrhs < 1) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 1) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
+
+  RegisterHandle& handle = getRegisterHandle(prhs[0]);
+  commandDeviceLock.lock(findDeviceSlot(handle.deviceHandle)->transferMutex);
+  plhs[0] = handle.read();
+}
+
+/**
+ * @brief writeRegisterHandle
+ *
+ * Parameter: register handle, value
+ */
+void writeRegisterHandle(unsigned int, mxArray**, unsigned int nrhs, const mxArray* prhs[]) {
+  static const unsigned int pp_handle = 0, pp_value = 1;
+
+  if(nrhs < 2) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 2) mexWarnMsgTxt("Too many input arguments.");
+
+  RegisterHandle& handle = getRegisterHandle(prhs[pp_handle]);
+  commandDeviceLock.lock(findDeviceSlot(handle.deviceHandle)->transferMutex);
+
+  if((!mxIsNumeric(prhs[pp_value]) && !mxIsLogical(prhs[pp_value])) || mxIsComplex(prhs[pp_value]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_value) + " input argument.");
+
+  handle.write(prhs[pp_value]);
+}
+
+/**
+ * @brief A register given as {module, register, [offset], [elements]} cell
+ */
+struct RegisterSpec {
+  RegisterPath path;
+  uint32_t offset;
+  uint32_t nElements;
+};
+
+/**
+ * @brief Parses a cell array of register specs
+ *
+ * @param[in] prhsSpecs Cell array with one {module, register, [offset], [elements]} cell per register
+ */
+std::vector<RegisterSpec> parseRegisterSpecs(const mxArray* prhsSpecs) {
+  static const unsigned int ps_module = 0, ps_register = 1, ps_offset = 2, ps_elements = 3;
+
+  if(!mxIsCell(prhsSpecs)) mexErrMsgTxt("Register specs must be a cell array.");
+
+  std::vector<RegisterSpec> specs(mxGetNumberOfElements(prhsSpecs));
+
+  for(size_t i = 0; i < specs.size(); ++i) {
+    const mxArray* spec = mxGetCell(prhsSpecs, i);
+    const std::string where = " in register spec " + std::to_string(i + 1) + ".";
+
+    if(!spec || !mxIsCell(spec)) mexErrMsgTxt("Invalid register spec " + std::to_string(i + 1) + ".");
+    const size_t nFields = mxGetNumberOfElements(spec);
+    if(nFields < 2 || nFields > 4) mexErrMsgTxt("Invalid number of entries" + where);
+
+    const mxArray* module = mxGetCell(spec, ps_module);
+    const mxArray* reg = mxGetCell(spec, ps_register);
+    if(!module || !mxIsChar(module)) mexErrMsgTxt("Invalid module name" + where);
+    if(!reg || !mxIsChar(reg)) mexErrMsgTxt("Invalid register name" + where);
+    specs[i].path = RegisterPath(mxArrayToStdString(module)) / RegisterPath(mxArrayToStdString(reg));
+
+    const mxArray* offset = (nFields > ps_offset) ? mxGetCell(spec, ps_offset) : NULL;
+    if(offset && (!mxIsRealScalar(offset) || (mxGetScalar(offset) < 0))) mexErrMsgTxt("Invalid offset" + where);
+    specs[i].offset = offset ? mxGetScalar(offset) : 0;
+
+    // number of elements is optional. Use 0 (=all remaining) if not set
+    const mxArray* elements = (nFields > ps_elements) ? mxGetCell(spec, ps_elements) : NULL;
+    if(elements && !mxIsPositiveRealScalar(elements)) mexErrMsgTxt("Invalid number of elements" + where);
+    specs[i].nElements = elements ? mxGetScalar(elements) : 0;
+  }
+
+  return specs;
+}
+
+/**
+ * @brief readMany
+ *
+ * Reads a list of registers with a single TransferGroup, so adjacent areas
+ * are merged into as few transfers as the backend allows. Returns a cell
+ * array of the same size as the specs.
+ *
+ * Parameter: device, {{module, register, [offset], [elements]}, ...}
+ */
+void readMany(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  static const unsigned int pp_device = 0, pp_specs = 1;
+
+  if(nrhs < 2) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 2) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
+
+  boost::shared_ptr<Device> device = getDevice(prhs[pp_device]);
+  std::vector<RegisterSpec> specs = parseRegisterSpecs(prhs[pp_specs]);
+
+  std::vector<OneDRegisterAccessor<double>> accessors;
+  accessors.reserve(specs.size());
+  TransferGroup group;
+  for(auto& spec : specs) {
+    accessors.push_back(device->getOneDRegisterAccessor<double>(spec.path, spec.nElements, spec.offset));
+    group.addAccessor(accessors.back());
+  }
+
+  group.read();
+
+  plhs[0] = mxCreateCellMatrix(mxGetM(prhs[pp_specs]), mxGetN(prhs[pp_specs]));
+  for(size_t i = 0; i < accessors.size(); ++i) {
+    mxArray* value = mxCreateUninitNumericMatrix(1, accessors[i].getNElements(), mxDOUBLE_CLASS, mxREAL);
+    memcpy(mxGetData(value), accessors[i].data(), accessors[i].getNElements() * sizeof(double));
+    mxSetCell(plhs[0], i, value);
+  }
+}
+
+/**
+ * @brief Writes a Matlab array with elements of SourceType through an accessor of UserType
+ *
+ * UserType is the Matlab class itself except for logical, so the data is
+ * moved into the accessor buffer with a memcpy and DeviceAccess does the
+ * conversion to the register type.
+ */
+template<typename SourceType, typename UserType>
+void writeToDevice(Device& device, const RegisterPath& registerPath, const mxArray* value, size_t offset) {
+  const size_t nElements = mxGetNumberOfElements(value);
+  statistics.phase(phaseSetup);
+  auto accessor = device.getOneDRegisterAccessor<UserType>(registerPath, nElements, offset);
+  statistics.phase(phaseConversion);
+  std::copy_n(static_cast<const SourceType*>(mxGetData(value)), nElements, accessor.data());
+  statistics.phase(phaseTransfer);
+  accessor.write();
+  statistics.addBytes(registerPath, nElements * sizeof(UserType));
+}
+
+/**
+ * @brief Returns the writeToDevice instance for a Matlab class, NULL if the class is not supported
+ */
+WriteFnc getWriteFunction(mxClassID classID) {
+  static const std::vector<WriteFnc> writeFunctions = [] {
+    std::vector<WriteFnc> table(mxFUNCTION_CLASS + 1, NULL);
+    for(mxClassID tableClassID : {mxDOUBLE_CLASS, mxSINGLE_CLASS, mxINT8_CLASS, mxUINT8_CLASS, mxINT16_CLASS,
+            mxUINT16_CLASS, mxINT32_CLASS, mxUINT32_CLASS, mxINT64_CLASS, mxUINT64_CLASS}) {
+      callForMxClass(tableClassID, [&](auto v) { table[tableClassID] = &writeToDevice<decltype(v)>; });
+    }
+    // DeviceAccess has no bool user type, logicals are written as uint8
+    table[mxLOGICAL_CLASS] = &writeToDevice<mxLogical, uint8_t>;
+    return table;
+  }();
+
+  if(size_t(classID) >= writeFunctions.size()) return NULL;
+  return writeFunctions[classID];
+}
+
+/**
+ * @brief Stops all native threads, called by Matlab when the mex file is cleared
+ */
+void cleanUp() {
+  commandDeviceLock.release();
+  acquisitionsVector.clear();
+  recordersVector.clear();
+  // The mex file is locked while probes run (see getInfo), so this is only
+  // reached with running probes when Matlab exits. Their code lives in the
+  // mex file, so they are never detached.
+  for(auto& probeThread : probeThreads) probeThread.second.join();
+  probeThreads.clear();
+  remoteConnectionsMap.clear();
+  workerPool.stop();
+  readTicketsMap.clear();
+}
+
+Acquisition::Acquisition(size_t deviceHandle_, std::shared_ptr<std::mutex> transferMutex_,
+    OneDRegisterAccessor<double> accessor_, double period_, size_t capacity_)
+: deviceHandle(deviceHandle_), transferMutex(std::move(transferMutex_)), accessor(accessor_), period(period_),
+  capacity(capacity_),
+  nElements(accessor.getNElements()), buffer(capacity * nElements), timestamps(capacity) {
+  thread = std::thread(&Acquisition::run, this);
+}
+
+Acquisition::~Acquisition() {
+  stop();
+}
+
+void Acquisition::stop() {
+  stopSignal.request();
+  if(thread.joinable()) thread.join();
+}
+
+std::string Acquisition::getError() {
+  std::lock_guard<std::mutex> lock(errorMutex);
+  return error;
+}
+
+void Acquisition::run() {
+  const bool waitForNewData = (period.count() == 0);
+  auto nextRead = std::chrono::steady_clock::now();
+  // Interval to poll the queue of a push-type accessor. Polling with
+  // readNonBlocking() keeps the thread stoppable without interrupting a read().
+  const auto pollInterval = std::chrono::microseconds(100);
+
+  try {
+    while(true) {
+      if(waitForNewData) {
+        if(stopSignal.waitFor(pollInterval)) return;
+      }
+      else {
+        if(stopSignal.waitUntil(nextRead)) return;
+        nextRead += std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+      }
+
+      std::lock_guard<std::mutex> lock(*transferMutex);
+      if(waitForNewData) {
+        // Drain the queue, several updates may have arrived since the last wake-up
+        while(accessor.readNonBlocking()) storeBlock();
+      }
+      else {
+        accessor.read();
+        storeBlock();
+      }
+    }
+  }
+  catch(std::exception& e) {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    error = e.what();
+  }
+}
+
+void Acquisition::storeBlock() {
+  const size_t currentHead = head.load(std::memory_order_relaxed);
+  if(currentHead - tail.load(std::memory_order_acquire) >= capacity) {
+    // Ring buffer full, drop the new block
+    ++overruns;
+    return;
+  }
+  const size_t index = currentHead % capacity;
+  memcpy(&buffer[index * nElements], accessor.data(), nElements * sizeof(double));
+  timestamps[index] = getPosixTime();
+  head.store(currentHead + 1, std::memory_order_release);
+}
+
+void Acquisition::fetch(mxArray** data, mxArray** blockTimestamps) {
+  const size_t currentTail = tail.load(std::memory_order_relaxed);
+  const size_t nBlocks = head.load(std::memory_order_acquire) - currentTail;
+
+  *data = mxCreateUninitNumericMatrix(nElements, nBlocks, mxDOUBLE_CLASS, mxREAL);
+  *blockTimestamps = mxCreateUninitNumericMatrix(1, nBlocks, mxDOUBLE_CLASS, mxREAL);
+  double* dataValue = mxGetPr(*data);
+  double* timestampValue = mxGetPr(*blockTimestamps);
+
+  // The blocks are contiguous up to the end of the ring and then continue at its beginning
+  const size_t first = currentTail % capacity;
+  const size_t nFirst = std::min(nBlocks, capacity - first);
+  memcpy(dataValue, &buffer[first * nElements], nFirst * nElements * sizeof(double));
+  memcpy(timestampValue, &timestamps[first], nFirst * sizeof(double));
+  memcpy(dataValue + nFirst * nElements, buffer.data(), (nBlocks - nFirst) * nElements * sizeof(double));
+  memcpy(timestampValue + nFirst, timestamps.data(), (nBlocks - nFirst) * sizeof(double));
+
+  tail.store(currentTail + nBlocks, std::memory_order_release);
+}
+
+Acquisition& getAcquisition(const mxArray* prhsHandle) {
+  if(!mxIsRealScalar(prhsHandle)) mexErrMsgTxt("Invalid acquisition handle.");
+
+  const size_t acquisitionHandle = mxGetScalar(prhsHandle);
+
+  if(acquisitionHandle >= acquisitionsVector.size()) mexErrMsgTxt("Invalid acquisition handle.");
+
+  if(!acquisitionsVector[acquisitionHandle]) mexErrMsgTxt("Acquisition stopped.");
+
+  return *acquisitionsVector[acquisitionHandle];
+}
+
+void stopAcquisitions(size_t deviceHandle) {
+  for(auto& acquisition : acquisitionsVector) {
+    if(acquisition && (acquisition->deviceHandle == deviceHandle)) acquisition.reset();
+  }
+}
+
+/**
+ * @brief startAcquisition
+ *
+ * Starts a native thread reading the register into a ring buffer. The period
+ * is given in seconds, or as 'push' to read every new block of a register
+ * supporting wait_for_new_data. Returns an acquisition handle.
+ *
+ * Parameter: device, module, register, period, [capacity], [offset], [elements]
+ * capacity is the number of blocks kept between two acq_fetch calls (default 1000)
+ */
+void startAcquisition(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  static const unsigned int pp_device = 0, pp_module = 1, pp_register = 2, pp_period = 3, pp_capacity = 4,
+                            pp_offset = 5, pp_elements = 6;
+
+  if(nrhs < 4) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 7) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
+
+  boost::shared_ptr<Device> device = getDevice(prhs[pp_device]);
+  const size_t deviceHandle = mxGetScalar(prhs[pp_device]);
+
+  if(!mxIsChar(prhs[pp_module])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_module) + " input argument.");
+  if(!mxIsChar(prhs[pp_register])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_register) + " input argument.");
+
+  const bool waitForNewData = mxIsChar(prhs[pp_period]) && (mxArrayToStdString(prhs[pp_period]) == "push");
+  if(!waitForNewData && !mxIsPositiveRealScalar(prhs[pp_period]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_period) + " input argument.");
+  if((nrhs > pp_capacity) && !mxIsPositiveRealScalar(prhs[pp_capacity]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_capacity) + " input argument.");
+  if((nrhs > pp_offset) && (!mxIsRealScalar(prhs[pp_offset]) || (mxGetScalar(prhs[pp_offset]) < 0)))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_offset) + " input argument.");
+  if((nrhs > pp_elements) && !mxIsPositiveRealScalar(prhs[pp_elements]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_elements) + " input argument.");
+
+  const double period = waitForNewData ? 0 : mxGetScalar(prhs[pp_period]);
+  const size_t capacity = (nrhs > pp_capacity) ? mxGetScalar(prhs[pp_capacity]) : 1000;
+  const uint32_t offset = (nrhs > pp_offset) ? mxGetScalar(prhs[pp_offset]) : 0;
+  const uint32_t nElements = (nrhs > pp_elements) ? mxGetScalar(prhs[pp_elements]) : 0;
+
+  RegisterPath registerPath(mxArrayToStdString(prhs[pp_module]) + "/" + mxArrayToStdString(prhs[pp_register]));
+
+  // The accessor is created here, so errors are reported directly to Matlab
+  OneDRegisterAccessor<double> accessor;
+  if(waitForNewData) {
+    accessor = device->getOneDRegisterAccessor<double>(registerPath, nElements, offset, {AccessMode::wait_for_new_data});
+    device->activateAsyncRead();
+  }
+  else {
+    accessor = device->getOneDRegisterAccessor<double>(registerPath, nElements, offset);
+  }
+
+  acquisitionsVector.emplace_back(
+      new Acquisition(deviceHandle, findDeviceSlot(deviceHandle)->transferMutex, accessor, period, capacity));
+
+  plhs[0] = mxCreateDoubleMatrix(1, 1, mxREAL);
+  (*mxGetPr(plhs[0])) = acquisitionsVector.size() - 1;
+}
+
+/**
+ * @brief fetchAcquisition
+ *
+ * Returns all blocks read since the last call as columns of a matrix, the
+ * posix time of each block and the number of blocks dropped because the ring
+ * buffer was full.
+ *
+ * Parameter: acquisition handle
+ */
+void fetchAcquisition(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  if(nrhs < 1) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 1) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 3) mexErrMsgTxt("Too many output arguments.");
+
+  Acquisition& acquisition = getAcquisition(prhs[0]);
+
+  mxArray* timestamps;
+  acquisition.fetch(&plhs[0], &timestamps);
+  if(nlhs > 1)
+    plhs[1] = timestamps;
+  else
+    mxDestroyArray(timestamps);
+  if(nlhs > 2) plhs[2] = mxCreateDoubleScalar(acquisition.takeOverruns());
+
+  // The data read before the error is still returned
+  const std::string error = acquisition.getError();
+  if(!error.empty()) mexWarnMsgTxt("Acquisition terminated: " + error);
+}
+
+/**
+ * @brief stopAcquisition
+ *
+ * Parameter: acquisition handle
+ */
+void stopAcquisition(unsigned int, mxArray**, unsigned int nrhs, const mxArray* prhs[]) {
+  if(nrhs < 1) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 1) mexWarnMsgTxt("Too many input arguments.");
+
+  getAcquisition(prhs[0]);
+  acquisitionsVector[size_t(mxGetScalar(prhs[0]))].reset();
+}
+
+void releasePushAccessors(size_t deviceHandle) {
+  for(auto it = pushAccessorsMap.begin(); it != pushAccessorsMap.end();) {
+    if(it->first.first == deviceHandle)
+      it = pushAccessorsMap.erase(it);
+    else
+      ++it;
+  }
+}
+
+/**
+ * @brief readWait
+ *
+ * Reads a register through a cached push-type accessor (wait_for_new_data).
+ * Returns the data, a flag whether new data has been received and the
+ * version number of the data as posix time in seconds. Version numbers are
+ * unique and increase with each update, so equal values identify the same
+ * update, also across registers updated together.
+ *
+ * Parameter: device, module, register, [timeout], [mode]
+ * timeout is given in seconds (default 10). It must be finite, as the wait
+ * cannot be interrupted from Matlab.
+ * mode is 'wait' (default, wait for the next update), 'nonblocking' (take the
+ * next update if there is one) or 'latest' (skip to the newest update).
+ */
+void readWait(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  static const unsigned int pp_device = 0, pp_module = 1, pp_register = 2, pp_timeout = 3, pp_mode = 4;
+
+  if(nrhs < 3) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 5) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 3) mexErrMsgTxt("Too many output arguments.");
+
+  boost::shared_ptr<Device> device = getDevice(prhs[pp_device]);
+  const size_t deviceHandle = mxGetScalar(prhs[pp_device]);
+
+  if(!mxIsChar(prhs[pp_module])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_module) + " input argument.");
+  if(!mxIsChar(prhs[pp_register])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_register) + " input argument.");
+  if((nrhs > pp_timeout) &&
+      (!mxIsRealScalar(prhs[pp_timeout]) || (mxGetScalar(prhs[pp_timeout]) < 0) ||
+          !std::isfinite(mxGetScalar(prhs[pp_timeout]))))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_timeout) + " input argument.");
+  if((nrhs > pp_mode) && !mxIsChar(prhs[pp_mode]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_mode) + " input argument.");
+
+  const double timeout = (nrhs > pp_timeout) ? mxGetScalar(prhs[pp_timeout]) : 10;
+  const std::string mode = (nrhs > pp_mode) ? mxArrayToStdString(prhs[pp_mode]) : "wait";
+  if((mode != "wait") && (mode != "nonblocking") && (mode != "latest")) mexErrMsgTxt("Unknown mode '" + mode + "'.");
+
+  const std::string registerPath =
+      RegisterPath(mxArrayToStdString(prhs[pp_module]) + "/" + mxArrayToStdString(prhs[pp_register]));
+
+  auto key = std::make_pair(deviceHandle, registerPath);
+  auto it = pushAccessorsMap.find(key);
+  if(it == pushAccessorsMap.end()) {
+    PushAccessor pushAccessor;
+    pushAccessor.accessor =
+        device->getOneDRegisterAccessor<double>(registerPath, 0, 0, {AccessMode::wait_for_new_data});
+    device->activateAsyncRead();
+    it = pushAccessorsMap.emplace(key, pushAccessor).first;
+  }
+  PushAccessor& pushAccessor = it->second;
+
+  bool received = false;
+  if(mode == "latest") {
+    received = pushAccessor.accessor.readLatest();
+  }
+  else if(mode == "nonblocking") {
+    received = pushAccessor.accessor.readNonBlocking();
+  }
+  else {
+    // read() cannot time out, so the queue is polled with a growing sleep
+    // between 10 us and 1 ms. The data is still pushed by the backend, the
+    // device itself is not polled. The device is only locked for each poll,
+    // so the native threads can use it meanwhile.
+    std::shared_ptr<std::mutex> transferMutex = findDeviceSlot(deviceHandle)->transferMutex;
+    commandDeviceLock.release();
+    auto poll = [&] {
+      std::lock_guard<std::mutex> lock(*transferMutex);
+      return pushAccessor.accessor.readNonBlocking();
+    };
+    const auto start = std::chrono::steady_clock::now();
+    auto sleep = std::chrono::microseconds(10);
+    while(!(received = poll())) {
+      if(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= timeout) break;
+      std::this_thread::sleep_for(sleep);
+      sleep = std::min(sleep * 2, std::chrono::microseconds(1000));
+    }
+  }
+
+  const size_t nElements = pushAccessor.accessor.getNElements();
+  plhs[0] = mxCreateUninitNumericMatrix(1, nElements, mxDOUBLE_CLASS, mxREAL);
+  memcpy(mxGetPr(plhs[0]), pushAccessor.accessor.data(), nElements * sizeof(double));
+  if(nlhs > 1) plhs[1] = mxCreateLogicalScalar(received);
+  if(nlhs > 2) {
+    const auto versionTime = pushAccessor.accessor.getVersionNumber().getTime().time_since_epoch();
+    plhs[2] = mxCreateDoubleScalar(std::chrono::duration<double>(versionTime).count());
+  }
+}
+
+/**
+ * @brief Rounds up to the 8 byte alignment of the sections in a recording file
+ */
+size_t alignRecordSize(size_t size) {
+  return (size + 7) & ~size_t(7);
+}
+
+Recorder::Recorder(size_t deviceHandle_, std::shared_ptr<std::mutex> transferMutex_,
+    std::vector<std::unique_ptr<RecordedRegister>> registers_, FILE* file_, double period_)
+: deviceHandle(deviceHandle_), transferMutex(std::move(transferMutex_)), registers(std::move(registers_)), file(file_),
+  period(period_) {
+  size_t blockSize = sizeof(double);
+  for(auto& reg : registers) {
+    group.addAccessor(reg->getAccessor());
+    blockSize += alignRecordSize(reg->nChannels * reg->nElementsPerChannel * reg->elementSize);
+  }
+  block.resize(blockSize, 0);
+  thread = std::thread(&Recorder::run, this);
+}
+
+Recorder::~Recorder() {
+  stop();
+}
+
+void Recorder::stop() {
+  stopSignal.request();
+  if(thread.joinable()) thread.join();
+  if(file) {
+    fclose(file);
+    file = NULL;
+  }
+}
+
+std::string Recorder::getError() {
+  std::lock_guard<std::mutex> lock(errorMutex);
+  return error;
+}
+
+void Recorder::run() {
+  auto nextRead = std::chrono::steady_clock::now();
+
+  try {
+    while(!stopSignal.waitUntil(nextRead)) {
+      nextRead += std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+
+      {
+        std::lock_guard<std::mutex> lock(*transferMutex);
+        group.read();
+      }
+
+      const double now = getPosixTime();
+      memcpy(block.data(), &now, sizeof(double));
+      char* position = block.data() + sizeof(double);
+      for(auto& reg : registers) {
+        reg->copyTo(position);
+        position += alignRecordSize(reg->nChannels * reg->nElementsPerChannel * reg->elementSize);
+      }
+
+      if(fwrite(block.data(), block.size(), 1, file) != 1) throw std::runtime_error("Cannot write to the file.");
+      ++nBlocks;
+    }
+  }
+  catch(std::exception& e) {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    error = e.what();
+  }
+}
+
+void stopRecordings(size_t deviceHandle) {
+  for(auto& recorder : recordersVector) {
+    if(recorder && (recorder->deviceHandle == deviceHandle)) recorder.reset();
+  }
+}
+
+/**
+ * @brief startRecording
+ *
+ * Starts a native thread which reads the registers with the given period and
+ * appends them to a binary file, see RecordFileHeader for the layout. 1D and
+ * 2D registers can be mixed, offset and elements apply to each channel.
+ * Returns a recording handle.
+ *
+ * Parameter: device, {{module, register, [offset], [elements]}, ...}, file name, period, [class]
+ * class is the Matlab class the values are stored as, see readRegister.
+ */
+void startRecording(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  static const unsigned int pp_device = 0, pp_specs = 1, pp_file = 2, pp_period = 3, pp_class = 4;
+
+  if(nrhs < 4) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 5) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
+
+  boost::shared_ptr<Device> device = getDevice(prhs[pp_device]);
+  const size_t deviceHandle = mxGetScalar(prhs[pp_device]);
+  std::vector<RegisterSpec> specs = parseRegisterSpecs(prhs[pp_specs]);
+
+  if(!mxIsChar(prhs[pp_file])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_file) + " input argument.");
+  if(!mxIsPositiveRealScalar(prhs[pp_period]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_period) + " input argument.");
+  if((nrhs > pp_class) && !mxIsChar(prhs[pp_class]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_class) + " input argument.");
+  if(specs.empty()) mexErrMsgTxt("No registers to record.");
+
+  std::vector<std::unique_ptr<RecordedRegister>> registers;
+  for(auto& spec : specs) {
+    const mxClassID classID =
+        (nrhs > pp_class) ? getOutputMxClassID(prhs[pp_class], *device, spec.path) : mxDOUBLE_CLASS;
+    callForMxClass(classID, [&](auto v) {
+      typedef decltype(v) UserType;
+      auto reg = new RecordedRegisterImpl<UserType>;
+      registers.emplace_back(reg);
+      reg->accessor = device->getTwoDRegisterAccessor<UserType>(spec.path, spec.nElements, spec.offset);
+      reg->nChannels = reg->accessor.getNChannels();
+      reg->nElementsPerChannel = reg->accessor.getNElementsPerChannel();
+      reg->elementSize = sizeof(UserType);
+    });
+    registers.back()->name = spec.path;
+    registers.back()->classID = classID;
+  }
+
+  // Build the header
+  std::vector<char> header(sizeof(RecordFileHeader));
+  for(auto& reg : registers) {
+    RecordRegisterHeader registerHeader = {};
+    for(auto& className : getMxClassNames()) {
+      if(className.second == reg->classID) strncpy(registerHeader.className, className.first.c_str(), 8);
+    }
+    registerHeader.nChannels = reg->nChannels;
+    registerHeader.nElementsPerChannel = reg->nElementsPerChannel;
+    registerHeader.nameLength = reg->name.size();
+
+    const size_t position = header.size();
+    header.resize(alignRecordSize(position + sizeof(RecordRegisterHeader) + reg->name.size()), 0);
+    memcpy(&header[position], &registerHeader, sizeof(RecordRegisterHeader));
+    memcpy(&header[position + sizeof(RecordRegisterHeader)], reg->name.data(), reg->name.size());
+  }
+
+  RecordFileHeader fileHeader = {};
+  memcpy(fileHeader.magic, recordMagic, sizeof(recordMagic));
+  fileHeader.formatVersion = recordFormatVersion;
+  fileHeader.nRegisters = registers.size();
+  fileHeader.headerSize = header.size();
+  fileHeader.blockSize = sizeof(double);
+  for(auto& reg : registers) {
+    fileHeader.blockSize += alignRecordSize(reg->nChannels * reg->nElementsPerChannel * reg->elementSize);
+  }
+  memcpy(header.data(), &fileHeader, sizeof(RecordFileHeader));
+
+  const std::string fileName = mxArrayToStdString(prhs[pp_file]);
+  FILE* file = fopen(fileName.c_str(), "wb");
+  if(!file) mexErrMsgTxt("Cannot open '" + fileName + "' for writing.");
+  if(fwrite(header.data(), header.size(), 1, file) != 1) {
+    fclose(file);
+    mexErrMsgTxt("Cannot write to '" + fileName + "'.");
+  }
+
+  recordersVector.emplace_back(new Recorder(deviceHandle, findDeviceSlot(deviceHandle)->transferMutex,
+      std::move(registers), file, mxGetScalar(prhs[pp_period])));
+
+  plhs[0] = mxCreateDoubleMatrix(1, 1, mxREAL);
+  (*mxGetPr(plhs[0])) = recordersVector.size() - 1;
+}
+
+/**
+ * @brief stopRecording
+ *
+ * Stops the recording and closes the file. Returns the number of blocks written.
+ *
+ * Parameter: recording handle
+ */
+void stopRecording(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  if(nrhs < 1) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 1) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
+
+  if(!mxIsRealScalar(prhs[0])) mexErrMsgTxt("Invalid recording handle.");
+  const size_t recordingHandle = mxGetScalar(prhs[0]);
+  if(recordingHandle >= recordersVector.size()) mexErrMsgTxt("Invalid recording handle.");
+  if(!recordersVector[recordingHandle]) mexErrMsgTxt("Recording stopped.");
+
+  std::unique_ptr<Recorder> recorder = std::move(recordersVector[recordingHandle]);
+  recorder->stop();
+
+  plhs[0] = mxCreateDoubleScalar(recorder->getNumberOfBlocks());
+
+  const std::string error = recorder->getError();
+  if(!error.empty()) mexWarnMsgTxt("Recording terminated: " + error);
+}
+
+/**
+ * @brief openRecording
+ *
+ * Maps a recording file and returns a struct with the register descriptions
+ * and the number of blocks. If a block range is given, the struct also
+ * contains the timestamps and for each register an
+ * elements x channels x blocks array of that range. Only the pages of the
+ * requested blocks are read from disk.
+ *
+ * Parameter: file name, [offset], [blocks]
+ * offset is the zero based index of the first block, blocks 0 means all remaining.
+ */
+void openRecording(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  static const unsigned int pp_file = 0, pp_offset = 1, pp_blocks = 2;
+
+  if(nrhs < 1) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 3) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
+
+  if(!mxIsChar(prhs[pp_file])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_file) + " input argument.");
+  if((nrhs > pp_offset) && (!mxIsRealScalar(prhs[pp_offset]) || (mxGetScalar(prhs[pp_offset]) < 0)))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_offset) + " input argument.");
+  if((nrhs > pp_blocks) && (!mxIsRealScalar(prhs[pp_blocks]) || (mxGetScalar(prhs[pp_blocks]) < 0)))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_blocks) + " input argument.");
+
+  const std::string fileName = mxArrayToStdString(prhs[pp_file]);
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if(fd < 0) mexErrMsgTxt("Cannot open '" + fileName + "'.");
+  struct stat fileStatus;
+  if(fstat(fd, &fileStatus) != 0 || size_t(fileStatus.st_size) < sizeof(RecordFileHeader)) {
+    close(fd);
+    mexErrMsgTxt("Invalid recording file '" + fileName + "'.");
+  }
+  const size_t fileSize = fileStatus.st_size;
+  void* mapping = mmap(NULL, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(mapping == MAP_FAILED) mexErrMsgTxt("Cannot map '" + fileName + "'.");
+  const char* fileData = static_cast<const char*>(mapping);
+
+  // Unmap before reporting errors, mexErrMsgTxt does not return
+  auto fail = [&](const std::string& message) {
+    munmap(mapping, fileSize);
+    mexErrMsgTxt(message + " in '" + fileName + "'.");
+  };
+
+  RecordFileHeader fileHeader;
+  memcpy(&fileHeader, fileData, sizeof(RecordFileHeader));
+  if(memcmp(fileHeader.magic, recordMagic, sizeof(recordMagic)) != 0) fail("No recording");
+  if(fileHeader.formatVersion != recordFormatVersion) fail("Unsupported format version");
+  if(fileHeader.headerSize > fileSize || fileHeader.headerSize < sizeof(RecordFileHeader) || fileHeader.blockSize == 0)
+    fail("Invalid header");
+  // Bound the allocations below by the header size
+  if(fileHeader.nRegisters > (fileHeader.headerSize - sizeof(RecordFileHeader)) / sizeof(RecordRegisterHeader))
+    fail("Invalid number of registers");
+
+  const size_t nBlocks = (fileSize - fileHeader.headerSize) / fileHeader.blockSize;
+  const size_t offset = (nrhs > pp_offset) ? mxGetScalar(prhs[pp_offset]) : 0;
+  if((nrhs > pp_offset) && (offset > nBlocks)) fail("Offset exceeds the number of blocks");
+  size_t blocks = (nrhs > pp_blocks) ? mxGetScalar(prhs[pp_blocks]) : 0;
+  if(blocks == 0) blocks = nBlocks - offset;
+  if(offset + blocks > nBlocks) fail("Block range exceeds the number of blocks");
+
+  const char* register_field_names[] = {"name", "class", "nChannels", "nElementsPerChannel"};
+  mxArray* registerInfo = mxCreateStructMatrix(fileHeader.nRegisters, 1, 4, register_field_names);
+
+  std::vector<RecordRegisterHeader> registerHeaders(fileHeader.nRegisters);
+  std::vector<mxClassID> classIDs(fileHeader.nRegisters);
+  size_t position = sizeof(RecordFileHeader);
+  for(size_t i = 0; i < registerHeaders.size(); ++i) {
+    if(position + sizeof(RecordRegisterHeader) > fileHeader.headerSize) fail("Invalid header");
+    memcpy(&registerHeaders[i], fileData + position, sizeof(RecordRegisterHeader));
+    position += sizeof(RecordRegisterHeader);
+    if(position + registerHeaders[i].nameLength > fileHeader.headerSize) fail("Invalid header");
+    const std::string name(fileData + position, registerHeaders[i].nameLength);
+    position = alignRecordSize(position + registerHeaders[i].nameLength);
+
+    const std::string className(registerHeaders[i].className, strnlen(registerHeaders[i].className, 8));
+    auto classIt = getMxClassNames().find(className);
+    if(classIt == getMxClassNames().end()) fail("Unknown class '" + className + "'");
+    classIDs[i] = classIt->second;
+
+    mxSetFieldByNumber(registerInfo, i, 0, mxCreateString(name.c_str()));
+    mxSetFieldByNumber(registerInfo, i, 1, mxCreateString(className.c_str()));
+    mxSetFieldByNumber(registerInfo, i, 2, mxCreateDoubleScalar(registerHeaders[i].nChannels));
+    mxSetFieldByNumber(registerInfo, i, 3, mxCreateDoubleScalar(registerHeaders[i].nElementsPerChannel));
+  }
+
+  const char* field_names[] = {"registers", "nBlocks", "offset", "timestamps", "data"};
+  plhs[0] = mxCreateStructMatrix(1, 1, (sizeof(field_names) / sizeof(*field_names)), field_names);
+  mxSetFieldByNumber(plhs[0], 0, 0, registerInfo);
+  mxSetFieldByNumber(plhs[0], 0, 1, mxCreateDoubleScalar(nBlocks));
+  mxSetFieldByNumber(plhs[0], 0, 2, mxCreateDoubleScalar(offset));
+
+  // Only the header is read without a block range
+  if(nrhs <= pp_offset) {
+    munmap(mapping, fileSize);
+    return;
+  }
+
+  const char* firstBlock = fileData + fileHeader.headerSize + offset * fileHeader.blockSize;
 
-  unsigned int index = 0;
-  for(auto cit = registerCatalogue.begin(); cit != registerCatalogue.end(); ++cit, ++index) {
-    mxSetFieldByNumber(plhs[0], index, 0, mxCreateString(std::string(cit->getRegisterName()).c_str()));
+  mxArray* timestamps = mxCreateUninitNumericMatrix(1, blocks, mxDOUBLE_CLASS, mxREAL);
+  double* timestampValues = mxGetPr(timestamps);
+  for(size_t block = 0; block < blocks; ++block) {
+    memcpy(&timestampValues[block], firstBlock + block * fileHeader.blockSize, sizeof(double));
+  }
+  mxSetFieldByNumber(plhs[0], 0, 3, timestamps);
+
+  mxArray* data = mxCreateCellMatrix(1, registerHeaders.size());
+  size_t registerPosition = sizeof(double);
+  for(size_t i = 0; i < registerHeaders.size(); ++i) {
+    size_t elementSize = 0;
+    callForMxClass(classIDs[i], [&](auto v) { elementSize = sizeof(v); });
+    const size_t registerSize =
+        size_t(registerHeaders[i].nChannels) * registerHeaders[i].nElementsPerChannel * elementSize;
+    if(registerPosition + registerSize > fileHeader.blockSize) fail("Invalid header");
+
+    size_t dims[3] = {registerHeaders[i].nElementsPerChannel, registerHeaders[i].nChannels, blocks};
+    mxArray* registerData = mxCreateUninitNumericArray(3, dims, classIDs[i], mxREAL);
+    char* registerValues = static_cast<char*>(mxGetData(registerData));
+    for(size_t block = 0; block < blocks; ++block) {
+      memcpy(registerValues + block * registerSize, firstBlock + block * fileHeader.blockSize + registerPosition,
+          registerSize);
+    }
+    mxSetCell(data, i, registerData);
+    registerPosition += alignRecordSize(registerSize);
+  }
+  mxSetFieldByNumber(plhs[0], 0, 4, data);
 
-    mxArray* numElements = mxCreateDoubleMatrix(1, 1, mxREAL);
-    *mxGetPr(numElements) = cit->getNumberOfElements();
-    mxSetFieldByNumber(plhs[0], index, 1, numElements);
+  munmap(mapping, fileSize);
+}
 
-    mxArray* numChannels = mxCreateDoubleMatrix(1, 1, mxREAL);
-    *mxGetPr(numChannels) = cit->getNumberOfChannels();
-    mxSetFieldByNumber(plhs[0], index, 2, numChannels);
+void TimeStats::add(double seconds) {
+  if((count == 0) || (seconds < min)) min = seconds;
+  if((count == 0) || (seconds > max)) max = seconds;
+  ++count;
+  total += seconds;
 
-    mxArray* numDimensions = mxCreateDoubleMatrix(1, 1, mxREAL);
-    *mxGetPr(numDimensions) = cit->getNumberOfDimensions();
-    mxSetFieldByNumber(plhs[0], index, 3, numDimensions);
+  size_t bin = 0;
+  for(double limit = 1e-6; (bin < nStatsHistogramBins - 1) && (seconds >= limit); limit *= 2) ++bin;
+  ++histogram[bin];
+}
 
-    auto fundamentalType = cit->getDataDescriptor().fundamentalType();
-    mxSetFieldByNumber(plhs[0], index, 4, mxCreateString(getFundamentalTypeString(fundamentalType).c_str()));
+mxArray* TimeStats::toMxArray() const {
+  const char* fieldNames[] = {"count", "total", "min", "max", "histogram"};
+  mxArray* value = mxCreateStructMatrix(1, 1, sizeof(fieldNames) / sizeof(*fieldNames), fieldNames);
+  mxSetField(value, 0, "count", mxCreateDoubleScalar(count));
+  mxSetField(value, 0, "total", mxCreateDoubleScalar(total));
+  mxSetField(value, 0, "min", mxCreateDoubleScalar(min));
+  mxSetField(value, 0, "max", mxCreateDoubleScalar(max));
+  mxArray* bins = mxCreateDoubleMatrix(1, nStatsHistogramBins, mxREAL);
+  std::copy_n(histogram, nStatsHistogramBins, mxGetPr(bins));
+  mxSetField(value, 0, "histogram", bins);
+  return value;
+}
 
-    mxSetFieldByNumber(plhs[0], index, 5, mxCreateString(""));
+void Statistics::begin() {
+  callStart = phaseStart = Clock::now();
+  currentPhase = phaseParse;
+  std::fill_n(phaseTimes, nStatsPhases, 0.);
+  std::fill_n(phaseUsed, nStatsPhases, false);
+  phaseUsed[phaseParse] = true;
+  currentDevice = noDevice;
+  if(trace.isEnabled()) trace.beginCall();
+}
+
+void Statistics::phase(StatsPhase next) {
+  const Clock::time_point now = Clock::now();
+  phaseTimes[currentPhase] += std::chrono::duration<double>(now - phaseStart).count();
+  if(trace.isEnabled()) trace.addPhase(currentPhase, phaseStart, now);
+  phaseStart = now;
+  currentPhase = next;
+  phaseUsed[next] = true;
+}
+
+void Statistics::end(size_t command) {
+  phase(currentPhase);
+  if(trace.isEnabled()) trace.endCall(command, callStart, phaseStart);
+  if(command >= commandStats.size()) commandStats.resize(command + 1);
+  CommandStats& stats = commandStats[command];
+  ++stats.calls;
+  stats.total.add(std::chrono::duration<double>(phaseStart - callStart).count());
+  for(size_t i = 0; i < nStatsPhases; ++i) {
+    if(phaseUsed[i]) stats.phases[i].add(phaseTimes[i]);
+  }
+}
+
+void Statistics::setDevice(size_t deviceHandle) {
+  currentDevice = deviceHandle;
+  if(trace.isEnabled()) trace.addDevice(deviceHandle);
+}
+
+void Statistics::addBytes(const RegisterPath& registerPath, size_t bytes) {
+  TransferStats& stats = transferStats[std::make_pair(currentDevice, std::string(registerPath))];
+  ++stats.transfers;
+  stats.bytes += bytes;
+  if(trace.isEnabled()) trace.addTransfer(registerPath, bytes);
+}
+
+void Statistics::reset() {
+  commandStats.clear();
+  transferStats.clear();
+}
+
+mxArray* Statistics::toMxArray() const {
+  std::vector<size_t> usedCommands;
+  for(size_t i = 0; i < commandStats.size(); ++i) {
+    if(commandStats[i].calls > 0) usedCommands.push_back(i);
+  }
+
+  const char* commandFields[] = {"name", "calls", "total", "parse", "setup", "transfer", "conversion"};
+  mxArray* commands =
+      mxCreateStructMatrix(1, usedCommands.size(), sizeof(commandFields) / sizeof(*commandFields), commandFields);
+  for(size_t i = 0; i < usedCommands.size(); ++i) {
+    const CommandStats& stats = commandStats[usedCommands[i]];
+    mxSetField(commands, i, "name", mxCreateString(vectorOfCommands[usedCommands[i]].Name.c_str()));
+    mxSetField(commands, i, "calls", mxCreateDoubleScalar(stats.calls));
+    mxSetField(commands, i, "total", stats.total.toMxArray());
+    for(size_t p = 0; p < nStatsPhases; ++p) {
+      mxSetField(commands, i, statsPhaseNames[p], stats.phases[p].toMxArray());
+    }
+  }
+
+  const char* transferFields[] = {"device", "register", "transfers", "bytes"};
+  mxArray* transfers =
+      mxCreateStructMatrix(1, transferStats.size(), sizeof(transferFields) / sizeof(*transferFields), transferFields);
+  size_t i = 0;
+  for(auto& entry : transferStats) {
+    const double device = (entry.first.first == noDevice) ? mxGetNaN() : double(entry.first.first);
+    mxSetField(transfers, i, "device", mxCreateDoubleScalar(device));
+    mxSetField(transfers, i, "register", mxCreateString(entry.first.second.c_str()));
+    mxSetField(transfers, i, "transfers", mxCreateDoubleScalar(entry.second.transfers));
+    mxSetField(transfers, i, "bytes", mxCreateDoubleScalar(entry.second.bytes));
+    ++i;
   }
+
+  mxArray* edges = mxCreateDoubleMatrix(1, nStatsHistogramBins, mxREAL);
+  double* edgesValue = mxGetPr(edges);
+  for(size_t bin = 0; bin < nStatsHistogramBins - 1; ++bin) edgesValue[bin] = std::ldexp(1e-6, bin);
+  edgesValue[nStatsHistogramBins - 1] = INFINITY;
+
+  const char* fieldNames[] = {"commands", "transfers", "histogram_edges"};
+  mxArray* value = mxCreateStructMatrix(1, 1, sizeof(fieldNames) / sizeof(*fieldNames), fieldNames);
+  mxSetField(value, 0, "commands", commands);
+  mxSetField(value, 0, "transfers", transfers);
+  mxSetField(value, 0, "histogram_edges", edges);
+  return value;
 }
 
 /**
- * @brief getRegisterInfo
+ * @brief getStats
  *
+ * Returns the performance counters as struct with the fields
+ *  - commands: struct array with name, calls and the time statistics total,
+ *    parse, setup, transfer and conversion of each used command
+ *  - transfers: struct array with device handle (NaN without device), register, transfers and bytes
+ *  - histogram_edges: upper bounds in seconds of the histogram bins
+ * Times are in seconds. The stats call itself is not included.
  */
-void getRegisterInfo(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+void getStats(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray**) {
+  if(nrhs > 0) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
+
+  plhs[0] = statistics.toMxArray();
+}
+
+/**
+ * @brief resetStats clears all performance counters
+ */
+void resetStats(unsigned int, mxArray**, unsigned int nrhs, const mxArray**) {
+  if(nrhs > 0) mexWarnMsgTxt("Too many input arguments.");
+
+  statistics.reset();
+}
+
+void Trace::start(size_t capacity) {
+  records.assign(capacity, TraceRecord());
+  nRecords = 0;
+  registerNames.clear();
+  registerIds.clear();
+  epoch = Clock::now();
+  enabled = true;
+}
+
+void Trace::beginCall() {
+  callHasDevice = false;
+  callBytes = 0;
+}
+
+void Trace::addPhase(StatsPhase phase, Clock::time_point begin, Clock::time_point end) {
+  TraceRecord& record = nextRecord();
+  record.kind = TraceRecord::phase;
+  record.id = phase;
+  record.start = toMicroseconds(begin);
+  record.duration = toMicroseconds(end) - record.start;
+}
+
+void Trace::addDevice(size_t deviceHandle) {
+  callDevice = deviceHandle;
+  callHasDevice = true;
+  TraceRecord& record = nextRecord();
+  record.kind = TraceRecord::device;
+  record.start = toMicroseconds(Clock::now());
+  record.deviceHandle = deviceHandle;
+}
+
+void Trace::addTransfer(const RegisterPath& registerPath, size_t bytes) {
+  auto id = registerIds.emplace(std::string(registerPath), registerNames.size());
+  if(id.second) registerNames.push_back(id.first->first);
+  callBytes += bytes;
+  TraceRecord& record = nextRecord();
+  record.kind = TraceRecord::transfer;
+  record.id = id.first->second;
+  record.start = toMicroseconds(Clock::now());
+  record.bytes = bytes;
+}
+
+void Trace::endCall(size_t command, Clock::time_point begin, Clock::time_point end) {
+  TraceRecord& record = nextRecord();
+  record.kind = TraceRecord::call;
+  record.id = command;
+  record.start = toMicroseconds(begin);
+  record.duration = toMicroseconds(end) - record.start;
+  record.deviceHandle = callDevice;
+  record.hasDevice = callHasDevice;
+  record.bytes = callBytes;
+}
+
+/**
+ * @brief Returns s as JSON string literal
+ */
+std::string toJsonString(const std::string& s) {
+  std::string json = "\"";
+  for(char c : s) {
+    if((c == '"') || (c == '\\')) json += '\\';
+    if(static_cast<unsigned char>(c) < 0x20) continue;
+    json += c;
+  }
+  return json + "\"";
+}
+
+long Trace::dump(FILE* file) const {
+  const int pid = getpid();
+  const uint64_t first = (nRecords > records.size()) ? nRecords - records.size() : 0;
+  fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+  for(uint64_t i = first; i < nRecords; ++i) {
+    const TraceRecord& record = records[i % records.size()];
+    fprintf(file, (i == first) ? "\n" : ",\n");
+    switch(record.kind) {
+      case TraceRecord::call:
+        fprintf(file,
+            "{\"name\": %s, \"cat\": \"command\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": %d, "
+            "\"tid\": 1, \"args\": {\"bytes\": %llu",
+            toJsonString(vectorOfCommands[record.id].Name).c_str(), record.start, record.duration, pid,
+            static_cast<unsigned long long>(record.bytes));
+        if(record.hasDevice) fprintf(file, ", \"device\": %zu", record.deviceHandle);
+        fprintf(file, "}}");
+        break;
+      case TraceRecord::phase:
+        fprintf(file,
+            "{\"name\": \"%s\", \"cat\": \"phase\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": %d, "
+            "\"tid\": 1}",
+            statsPhaseNames[record.id], record.start, record.duration, pid);
+        break;
+      case TraceRecord::device:
+        fprintf(file,
+            "{\"name\": \"get_device\", \"cat\": \"device\", \"ph\": \"i\", \"s\": \"t\", \"ts\": %.3f, "
+            "\"pid\": %d, \"tid\": 1, \"args\": {\"device\": %zu}}",
+            record.start, pid, record.deviceHandle);
+        break;
+      case TraceRecord::transfer:
+        fprintf(file,
+            "{\"name\": %s, \"cat\": \"transfer\", \"ph\": \"i\", \"s\": \"t\", \"ts\": %.3f, \"pid\": %d, "
+            "\"tid\": 1, \"args\": {\"bytes\": %llu}}",
+            toJsonString(registerNames[record.id]).c_str(), record.start, pid,
+            static_cast<unsigned long long>(record.bytes));
+        break;
+    }
+  }
+  fprintf(file, "\n]}\n");
+  return ferror(file) ? -1 : long(nRecords - first);
+}
+
+/**
+ * @brief startTrace
+ *
+ * Starts recording each call with its phases, device handle and transfers
+ * into a ring buffer. A running trace is restarted with an empty buffer.
+ *
+ * Parameter: [capacity]
+ * capacity is the number of records kept (default 65536). A call takes one
+ * record, plus one per phase, device lookup and transferred register.
+ */
+void startTrace(unsigned int, mxArray**, unsigned int nrhs, const mxArray* prhs[]) {
+  if(nrhs > 1) mexWarnMsgTxt("Too many input arguments.");
+  if((nrhs > 0) && (!mxIsPositiveRealScalar(prhs[0]) || (mxGetScalar(prhs[0]) > (1 << 26))))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(1) + " input argument.");
+
+  trace.start((nrhs > 0) ? size_t(mxGetScalar(prhs[0])) : defaultTraceCapacity);
+}
+
+/**
+ * @brief stopTrace stops recording, the records are kept for trace_dump
+ */
+void stopTrace(unsigned int, mxArray**, unsigned int nrhs, const mxArray**) {
+  if(nrhs > 0) mexWarnMsgTxt("Too many input arguments.");
+
+  trace.stop();
+}
+
+/**
+ * @brief dumpTrace
+ *
+ * Writes the records of the trace as Chrome trace-event JSON, which can be
+ * opened in chrome://tracing or Perfetto. Times are in microseconds since
+ * trace_start. Calls and phases are complete events, device lookups and
+ * transferred registers instant events. Failed calls only appear with the
+ * phases they finished.
+ *
+ * Parameter: file
+ * Returns the number of events written.
+ */
+void dumpTrace(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  if(nrhs < 1) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 1) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
+  if(!mxIsChar(prhs[0])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(1) + " input argument.");
+
+  const std::string fileName = mxArrayToStdString(prhs[0]);
+  FILE* file = fopen(fileName.c_str(), "w");
+  if(!file) mexErrMsgTxt("Cannot open '" + fileName + "' for writing.");
+  const long nEvents = trace.dump(file);
+  if((fclose(file) != 0) || (nEvents < 0)) mexErrMsgTxt("Cannot write to '" + fileName + "'.");
+
+  plhs[0] = mxCreateDoubleScalar(nEvents);
+}
+
+/**
+ * @brief findRegisters
+ *
+ * Parameter: device, pattern, [mode]
+ * Returns the names of the registers matching the pattern as Nx1 cell array in
+ * the order of the catalogue. The mode is 'glob' (default, '*' does not match
+ * '/') or 'regex' (matches any part of the name). The leading '/' of the
+ * register names is ignored.
+ */
+void findRegisters(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  static const unsigned int pp_device = 0, pp_pattern = 1, pp_mode = 2;
+
+  if(nrhs < 2) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 3) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
+
+  const CachedRegisterCatalogue& registerCatalogue = getRegisterCatalogue(prhs[pp_device]);
+
+  if(!mxIsChar(prhs[pp_pattern])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_pattern) + " input argument.");
+  if((nrhs > pp_mode) && !mxIsChar(prhs[pp_mode]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_mode) + " input argument.");
+
+  std::string pattern = mxArrayToStdString(prhs[pp_pattern]);
+  const std::string mode = (nrhs > pp_mode) ? mxArrayToStdString(prhs[pp_mode]) : "glob";
+
+  auto stripSlash = [](const std::string& name) { return (!name.empty() && name[0] == '/') ? name.substr(1) : name; };
+
+  std::vector<const CachedRegisterInfo*> matches;
+  if(mode == "glob") {
+    pattern = stripSlash(pattern);
+    if(pattern.find_first_of("*?[\\") == std::string::npos) {
+      // No wildcards, so a lookup in the index is sufficient
+      auto it = registerCatalogue.index.find(std::string(RegisterPath(pattern)));
+      if(it != registerCatalogue.index.end()) matches.push_back(&registerCatalogue.registers[it->second]);
+    }
+    else {
+      for(auto& registerInfo : registerCatalogue.registers) {
+        if(fnmatch(pattern.c_str(), stripSlash(registerInfo.name).c_str(), FNM_PATHNAME) == 0)
+          matches.push_back(&registerInfo);
+      }
+    }
+  }
+  else if(mode == "regex") {
+    std::regex expression;
+    try {
+      expression = std::regex(pattern);
+    }
+    catch(std::regex_error& e) {
+      mexErrMsgTxt(std::string("Invalid regular expression: ") + e.what());
+    }
+    for(auto& registerInfo : registerCatalogue.registers) {
+      if(std::regex_search(stripSlash(registerInfo.name), expression)) matches.push_back(&registerInfo);
+    }
+  }
+  else {
+    mexErrMsgTxt("Invalid mode '" + mode + "'. Use 'glob' or 'regex'.");
+  }
+
+  plhs[0] = mxCreateCellMatrix(matches.size(), 1);
+  for(size_t i = 0; i < matches.size(); ++i) mxSetCell(plhs[0], i, mxCreateString(matches[i]->name.c_str()));
+}
+
+/**
+ * @brief writeRaw
+ *
+ * Parameter: device, module, register, value, [offset], [signed], [bit], [fracbit]
+ * Without fixed point format the values are written as raw 32 bit words, they
+ * must be integers from intmin('int32') to intmax('uint32'). With a format
+ * they are converted while copying into the accessor, see fixedPointToRaw.
+ */
+void writeRaw(unsigned int, mxArray**, unsigned int nrhs, const mxArray* prhs[]) {
+  static const unsigned int pp_device = 0, pp_module = 1, pp_register = 2, pp_value = 3, pp_offset = 4,
+                            pp_signed = 5;
+
+  if(nrhs < 4) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 8) mexWarnMsgTxt("Too many input arguments.");
+
+  boost::shared_ptr<Device> device = getDevice(prhs[pp_device]);
+
+  if(!mxIsChar(prhs[pp_module])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_module) + " input argument.");
+  if(!mxIsChar(prhs[pp_register])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_register) + " input argument.");
+  if(!mxIsNumeric(prhs[pp_value]) || mxIsComplex(prhs[pp_value]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_value) + " input argument.");
+  if((nrhs > pp_offset) && (!mxIsRealScalar(prhs[pp_offset]) || (mxGetScalar(prhs[pp_offset]) < 0)))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_offset) + " input argument.");
+
+  const uint32_t offset = (nrhs > pp_offset) ? mxGetScalar(prhs[pp_offset]) : 0;
+  const bool convert = (nrhs > pp_signed);
+  FixedPointFormat format{false, 32, 0};
+  if(convert) format = parseFixedPointFormat(nrhs, prhs, pp_signed, 32);
+
+  RegisterPath registerPath(mxArrayToStdString(prhs[pp_module]) + "/" + mxArrayToStdString(prhs[pp_register]));
+  const size_t nElements = mxGetNumberOfElements(prhs[pp_value]);
+
+  statistics.phase(phaseSetup);
+  auto accessor = device->getOneDRegisterAccessor<int32_t>(registerPath, nElements, offset, {AccessMode::raw});
+  statistics.phase(phaseConversion);
+  if(convert) {
+    callForMxClass(mxGetClassID(prhs[pp_value]), [&](auto v) {
+      typedef decltype(v) SourceType;
+      fixedPointToRaw(static_cast<const SourceType*>(mxGetData(prhs[pp_value])), accessor.data(), nElements, format);
+    });
+  }
+  else {
+    callForMxClass(mxGetClassID(prhs[pp_value]), [&](auto v) {
+      typedef decltype(v) SourceType;
+      const SourceType* source = static_cast<const SourceType*>(mxGetData(prhs[pp_value]));
+      for(size_t i = 0; i < nElements; ++i) {
+        const double value = double(source[i]);
+        if(!(value >= double(INT32_MIN)) || (value > double(UINT32_MAX)) || (value != std::floor(value)))
+          mexErrMsgTxt("Invalid raw value at position " + std::to_string(i + 1) + ".");
+        accessor[i] = int32_t(uint32_t(int64_t(value)));
+      }
+    });
+  }
+  statistics.phase(phaseTransfer);
+  accessor.write();
+  statistics.addBytes(registerPath, nElements * sizeof(int32_t));
+}
+
+/**
+ * @brief Applies fnc(value, bit, fracbit) to each element of a numeric array
+ *
+ * Parameter: value, bit, fracbit
+ * The result is a double array of the same size. This is the common part of
+ * the standalone fixed point conversions cd2ui, cui2d, cd2si and csi2d.
+ */
+template<typename Function>
+void convertFixedPoint(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[], Function fnc) {
+  static const unsigned int pp_value = 0, pp_bit = 1, pp_fracbit = 2;
+
   if(nrhs < 3) mexErrMsgTxt("Not enough input arguments.");
   if(nrhs > 3) mexWarnMsgTxt("Too many input arguments.");
   if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
 
-  if(!mxIsChar(prhs[1])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(2) + " input argument.");
-  if(!mxIsChar(prhs[2])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(3) + " input argument.");
+  if(!mxIsNumeric(prhs[pp_value]) || mxIsComplex(prhs[pp_value]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_value + 1) + " input argument.");
+  if(!mxIsPositiveRealScalar(prhs[pp_bit]) || (mxGetScalar(prhs[pp_bit]) > 53) ||
+      (mxGetScalar(prhs[pp_bit]) != std::floor(mxGetScalar(prhs[pp_bit]))))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_bit + 1) + " input argument.");
+  if(!mxIsRealScalar(prhs[pp_fracbit]) || (std::fabs(mxGetScalar(prhs[pp_fracbit])) > 1000) ||
+      (mxGetScalar(prhs[pp_fracbit]) != std::floor(mxGetScalar(prhs[pp_fracbit]))))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_fracbit + 1) + " input argument.");
+
+  const double range = std::ldexp(1., int(mxGetScalar(prhs[pp_bit]))); // 2^bit
+  const double fracScale = std::ldexp(1., int(mxGetScalar(prhs[pp_fracbit]))); // 2^fracbit
+  const size_t nElements = mxGetNumberOfElements(prhs[pp_value]);
+
+  const mwSize* valueDims = mxGetDimensions(prhs[pp_value]);
+  std::vector<mwSize> dims(valueDims, valueDims + mxGetNumberOfDimensions(prhs[pp_value]));
+  plhs[0] = mxCreateUninitNumericArray(dims.size(), dims.data(), mxDOUBLE_CLASS, mxREAL);
+  double* destination = mxGetPr(plhs[0]);
+  callForMxClass(mxGetClassID(prhs[pp_value]), [&](auto v) {
+    typedef decltype(v) SourceType;
+    const SourceType* source = static_cast<const SourceType*>(mxGetData(prhs[pp_value]));
+    for(size_t i = 0; i < nElements; ++i) destination[i] = fnc(double(source[i]), range, fracScale);
+  });
+}
 
-  auto device = getDevice(prhs[0]);
-  auto registerCatalogue = device->getRegisterCatalogue();
+double saturate(double value, double minValue, double maxValue) {
+  return (value > maxValue) ? maxValue : ((value < minValue) ? minValue : value);
+}
 
-  RegisterPath moduleName(mxArrayToStdString(prhs[1]));
-  RegisterPath registerName(mxArrayToStdString(prhs[2]));
-  auto registerInfo = registerCatalogue.getRegister(moduleName / registerName);
-  auto& dataDescriptor = registerInfo.getDataDescriptor();
+/**
+ * @brief cd2ui: double to unsigned int with the given bit and fracbit, see matlab/cd2ui.m
+ */
+void convertDoubleToUnsigned(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  convertFixedPoint(nlhs, plhs, nrhs, prhs, [](double d, double range, double fracScale) {
+    const double value = saturate(std::round(d * fracScale), -range / 2, range / 2 - 1);
+    return (value < 0) ? value + range : value;
+  });
+}
 
-  //                    index: 0       1                      2            3 4
-  //                    5              6          7
-  const char* field_names[] = {"name", "nElementsPerChannel", "nChannels", "nDimensions", "fundamentalType",
-      "isIntegral", "isSigned", "description"};
-  plhs[0] = mxCreateStructMatrix(1, 1, (sizeof(field_names) / sizeof(*field_names)), field_names);
+/**
+ * @brief cui2d: unsigned int to double with the given bit and fracbit, see matlab/cui2d.m
+ */
+void convertUnsignedToDouble(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  convertFixedPoint(nlhs, plhs, nrhs, prhs, [](double ui, double range, double fracScale) {
+    const double value = saturate(std::round(ui), 0, range - 1);
+    return ((value > range / 2 - 1) ? value - range : value) / fracScale;
+  });
+}
 
-  mxSetFieldByNumber(plhs[0], 0, 0, mxCreateString(std::string(registerInfo.getRegisterName()).c_str()));
+/**
+ * @brief cd2si: double to signed int with the given bit and fracbit, see matlab/cd2si.m
+ */
+void convertDoubleToSigned(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  convertFixedPoint(nlhs, plhs, nrhs, prhs, [](double d, double range, double fracScale) {
+    return saturate(std::round(d * fracScale), -range / 2, range / 2 - 1);
+  });
+}
 
-  mxArray* numElements = mxCreateDoubleMatrix(1, 1, mxREAL);
-  *mxGetPr(numElements) = registerInfo.getNumberOfElements();
-  mxSetFieldByNumber(plhs[0], 0, 1, numElements);
+/**
+ * @brief csi2d: signed int to double with the given bit and fracbit, see matlab/csi2d.m
+ */
+void convertSignedToDouble(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  convertFixedPoint(nlhs, plhs, nrhs, prhs, [](double i, double range, double fracScale) {
+    return saturate(std::round(i), -range / 2, range / 2 - 1) / fracScale;
+  });
+}
 
-  mxArray* numChannels = mxCreateDoubleMatrix(1, 1, mxREAL);
-  *mxGetPr(numChannels) = registerInfo.getNumberOfChannels();
-  mxSetFieldByNumber(plhs[0], 0, 2, numChannels);
+/**
+ * @brief Connects to an mtca4u_server and returns the connection handle
+ *
+ * Parameter: address, [timeout]
+ * address is tcp://host:port, unix:///path or shm://name for the broker on this host.
+ * The connect and each request fail if the server does not make progress for
+ * timeout seconds (default 5), a request then drops the connection. The broker serves all sessions
+ * one after the other, so a slow request of another session may delay this
+ * one. Its connections are therefore only dropped if the broker is gone.
+ */
+void connectRemote(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  static const unsigned int pp_address = 0, pp_timeout = 1;
 
-  mxArray* numDimensions = mxCreateDoubleMatrix(1, 1, mxREAL);
-  *mxGetPr(numDimensions) = registerInfo.getNumberOfDimensions();
-  mxSetFieldByNumber(plhs[0], 0, 3, numDimensions);
+  if(nrhs < 1) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 2) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
 
-  auto fundamentalType = dataDescriptor.fundamentalType();
+  if(!mxIsChar(prhs[pp_address])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_address + 1) + " input argument.");
+  if((nrhs > pp_timeout) && !mxIsPositiveRealScalar(prhs[pp_timeout]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_timeout + 1) + " input argument.");
 
-  mxSetFieldByNumber(plhs[0], 0, 4, mxCreateString(getFundamentalTypeString(fundamentalType).c_str()));
+  const std::string address = mxArrayToStdString(prhs[pp_address]);
+  const double timeout = (nrhs > pp_timeout) ? mxGetScalar(prhs[pp_timeout]) : defaultRemoteTimeout;
+  std::string errorMessage;
+  std::unique_ptr<RemoteConnection> connection;
+  if(address.compare(0, mtca4u_protocol::shmPrefix.size(), mtca4u_protocol::shmPrefix) == 0) {
+    connection.reset(ShmConnection::connect(address, errorMessage));
+  }
+  else {
+    const int fd = mtca4u_protocol::openSocket(address, false, errorMessage, timeout);
+    if(fd >= 0) connection.reset(new SocketConnection(fd));
+  }
+  if(!connection) mexErrMsgTxt(errorMessage);
+  connection->timeout = timeout;
 
-  bool isIntegral = false; // default value in case the data type is not numeric
-  bool isSigned = false;   // default value in case the data type is not numeric
-  if(fundamentalType == DataDescriptor::FundamentalType::numeric) {
-    // These operations on the data descriptor are only valid for numeric types.
-    // They will throw otherwise.
-    isIntegral = dataDescriptor.isIntegral();
-    isSigned = dataDescriptor.isSigned();
+  const size_t connectionHandle = nextRemoteConnectionHandle++;
+  remoteConnectionsMap[connectionHandle] = std::move(connection);
+  plhs[0] = mxCreateDoubleScalar(connectionHandle);
+}
+
+ssize_t SocketConnection::sendSome(const char* data, size_t size) {
+  const ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+  if(n < 0) return ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)) ? 0 : -1;
+  return n;
+}
+
+ssize_t SocketConnection::receiveSome(char* data, size_t size) {
+  const ssize_t n = ::recv(fd, data, size, MSG_DONTWAIT);
+  if(n == 0) return -1; // closed by the server
+  if(n < 0) return ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)) ? 0 : -1;
+  return n;
+}
+
+bool SocketConnection::wait(bool sending) {
+  pollfd pfd{fd, short(POLLIN | (sending ? POLLOUT : 0)), 0};
+  // Bounded, so requestRemote can check its timeout
+  return (::poll(&pfd, 1, 100) >= 0) || (errno == EINTR);
+}
+
+ShmConnection* ShmConnection::connect(const std::string& address, std::string& errorMessage) {
+  using namespace mtca4u_protocol;
+  const std::string registryName = getShmRegistryName(address);
+  if(registryName.empty()) {
+    errorMessage = "Invalid address '" + address + "'.";
+    return NULL;
+  }
+
+  const int fd = shm_open(registryName.c_str(), O_RDWR, 0);
+  if(fd < 0) {
+    errorMessage = "No broker running on " + address + ".";
+    return NULL;
+  }
+  void* mapping = mmap(NULL, sizeof(ShmRegistry), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if(mapping == MAP_FAILED) {
+    errorMessage = "Cannot map the shared memory of " + address + ".";
+    return NULL;
+  }
+
+  std::unique_ptr<ShmConnection> connection(new ShmConnection());
+  connection->registryName = registryName;
+  connection->registry = static_cast<ShmRegistry*>(mapping);
+  if((connection->registry->magic != shmMagic) || !isProcessAlive(connection->registry->brokerPid)) {
+    errorMessage = "No broker running on " + address + ".";
+    return NULL;
+  }
+
+  for(auto& slot : connection->registry->slots) {
+    uint32_t expected = slotFree;
+    if(!slot.state.compare_exchange_strong(expected, slotClaimed)) continue;
+    slot.clientPid = getpid();
+    slot.requests.reset();
+    slot.responses.reset();
+    slot.state = slotConnected;
+    sem_post(&connection->registry->brokerWake);
+    connection->slot = &slot;
+    return connection.release();
+  }
+  errorMessage = "All " + std::to_string(shmSlots) + " slots of the broker on " + address + " are in use.";
+  return NULL;
+}
+
+ShmConnection::~ShmConnection() {
+  for(auto& segment : segments) munmap(segment.second.first, segment.second.second);
+  if(slot) {
+    slot->state = mtca4u_protocol::slotClosed;
+    sem_post(&registry->brokerWake);
+  }
+  if(registry) munmap(registry, sizeof(mtca4u_protocol::ShmRegistry));
+}
+
+ssize_t ShmConnection::sendSome(const char* data, size_t size) {
+  const size_t n = slot->requests.write(data, size);
+  if(n > 0) sem_post(&registry->brokerWake);
+  return n;
+}
+
+ssize_t ShmConnection::receiveSome(char* data, size_t size) {
+  const size_t n = slot->responses.readSome(data, size);
+  // The broker may be waiting for room in the ring
+  if(n > 0) sem_post(&registry->brokerWake);
+  return n;
+}
+
+bool ShmConnection::wait(bool) {
+  mtca4u_protocol::waitSemaphore(&slot->clientWake, 0.5);
+  return mtca4u_protocol::isProcessAlive(registry->brokerPid);
+}
+
+bool ShmConnection::isServerAlive() {
+  return mtca4u_protocol::isProcessAlive(registry->brokerPid);
+}
+
+void ShmConnection::pruneSegments() {
+  // The broker unlinks a segment when it is replaced or its device is closed,
+  // so a cached mapping whose name has gone would otherwise be kept forever
+  for(auto it = segments.begin(); it != segments.end();) {
+    const int fd = shm_open(it->first.c_str(), O_RDONLY, 0);
+    if(fd >= 0) {
+      ::close(fd);
+      ++it;
+    }
+    else if(errno == ENOENT) {
+      munmap(it->second.first, it->second.second);
+      it = segments.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+}
+
+void ShmConnection::copyBulk(const std::string& name, char* destination, size_t size) {
+  using namespace mtca4u_protocol;
+  auto it = segments.find(name);
+  if(it == segments.end()) {
+    // Only segments of this broker may be mapped
+    if(name.compare(0, registryName.size() + 1, registryName + "_") != 0) throw std::runtime_error("Malformed frame.");
+    pruneSegments();
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    struct stat status;
+    if((fd < 0) || (fstat(fd, &status) != 0)) {
+      if(fd >= 0) ::close(fd);
+      throw std::runtime_error("Cannot open the shared memory segment " + name + ".");
+    }
+    void* mapping = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(mapping == MAP_FAILED) throw std::runtime_error("Cannot map the shared memory segment " + name + ".");
+    it = segments.emplace(name, std::make_pair(static_cast<char*>(mapping), size_t(status.st_size))).first;
+  }
+  if(it->second.second < sizeof(ShmBulkHeader) + size) throw std::runtime_error("Malformed frame.");
+  const BulkCopyResult result = copyBulkSegment(it->second.first, destination, size, registry->brokerPid, timeout);
+  if(result == bulkSizeMismatch) throw std::runtime_error("Malformed frame.");
+  if(result == bulkStalled) throw std::runtime_error("The broker stalled while writing " + name + ".");
+}
+
+/**
+ * @brief Closes a connection to an mtca4u_server, the devices opened through it are closed by the server
+ *
+ * Parameter: connection
+ */
+void disconnectRemote(unsigned int, mxArray**, unsigned int nrhs, const mxArray* prhs[]) {
+  if(nrhs < 1) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 1) mexWarnMsgTxt("Too many input arguments.");
+
+  if(!mxIsRealScalar(prhs[0])) mexErrMsgTxt("Invalid connection handle.");
+  remoteConnectionsMap.erase(size_t(mxGetScalar(prhs[0])));
+}
+
+/**
+ * @brief Serialises one remote request {command, arguments...} and returns its opcode
+ *
+ * Commands: {'version'}, {'open', alias}, {'close', device},
+ * {'read', device, module, register, [offset], [elements]},
+ * {'read_raw', device, module, register, [offset], [elements]},
+ * {'write', device, module, register, value, [offset]},
+ * {'read_seq', device, module, register}, {'register_size', device, module, register},
+ * {'read_shared', device, module, register, max_age, [offset], [elements]}
+ * read_shared returns the data another client of the broker has read at most
+ * max_age seconds ago instead of reading it again.
+ */
+mtca4u_protocol::Opcode putRemoteRequest(const mxArray* request, const std::string& where, mtca4u_protocol::FrameWriter& frame) {
+  using namespace mtca4u_protocol;
+  static const size_t pr_command = 0, pr_device = 1, pr_module = 2, pr_register = 3, pr_value = 4;
+  static const std::map<std::string, Opcode> opcodes = {{"version", opVersion}, {"open", opOpen}, {"close", opClose},
+      {"read", opRead}, {"write", opWrite}, {"read_raw", opReadRaw}, {"read_seq", opReadSequence},
+      {"register_size", opRegisterSize}, {"read_shared", opReadShared}};
+
+  if(!request || !mxIsCell(request) || (mxGetNumberOfElements(request) == 0)) mexErrMsgTxt("Invalid request" + where);
+  const size_t nFields = mxGetNumberOfElements(request);
+  auto field = [&](size_t i) { return (i < nFields) ? mxGetCell(request, i) : NULL; };
+
+  const mxArray* command = field(pr_command);
+  if(!command || !mxIsChar(command)) mexErrMsgTxt("Invalid command" + where);
+  auto it = opcodes.find(mxArrayToStdString(command));
+  if(it == opcodes.end()) mexErrMsgTxt("Unknown command '" + mxArrayToStdString(command) + "'" + where);
+  const Opcode opcode = it->second;
+  frame.put<uint8_t>(opcode);
+
+  if(opcode == opVersion) return opcode;
+  if(opcode == opOpen) {
+    const mxArray* alias = field(pr_device);
+    if(!alias || !mxIsChar(alias)) mexErrMsgTxt("Invalid device alias" + where);
+    frame.putString(mxArrayToStdString(alias));
+    return opcode;
+  }
+
+  const mxArray* device = field(pr_device);
+  if(!device || !mxIsRealScalar(device) || (mxGetScalar(device) < 0)) mexErrMsgTxt("Invalid device handle" + where);
+  frame.put<uint32_t>(mxGetScalar(device));
+  if(opcode == opClose) return opcode;
+
+  const mxArray* module = field(pr_module);
+  const mxArray* reg = field(pr_register);
+  if(!module || !mxIsChar(module)) mexErrMsgTxt("Invalid module name" + where);
+  if(!reg || !mxIsChar(reg)) mexErrMsgTxt("Invalid register name" + where);
+  frame.putString(RegisterPath(mxArrayToStdString(module)) / RegisterPath(mxArrayToStdString(reg)));
+  if((opcode == opReadSequence) || (opcode == opRegisterSize)) return opcode;
+
+  // The value (or max age) comes before the offset, as in the local write command
+  const size_t pr_offset = ((opcode == opWrite) || (opcode == opReadShared)) ? pr_value + 1 : pr_value,
+               pr_elements = pr_offset + 1;
+  const mxArray* offset = field(pr_offset);
+  if(offset && (!mxIsRealScalar(offset) || (mxGetScalar(offset) < 0))) mexErrMsgTxt("Invalid offset" + where);
+  frame.put<uint32_t>(offset ? mxGetScalar(offset) : 0);
+
+  if(opcode == opWrite) {
+    const mxArray* value = field(pr_value);
+    if(!value || !mxIsNumeric(value) || mxIsComplex(value)) mexErrMsgTxt("Invalid value" + where);
+    double* data = frame.putArray<double>(mxGetNumberOfElements(value));
+    callForMxClass(mxGetClassID(value), [&](auto v) {
+      typedef decltype(v) SourceType;
+      std::copy_n(static_cast<const SourceType*>(mxGetData(value)), mxGetNumberOfElements(value), data);
+    });
+    return opcode;
+  }
+
+  // number of elements is optional. Use 0 (=all remaining) if not set
+  const mxArray* elements = field(pr_elements);
+  if(elements && !mxIsPositiveRealScalar(elements)) mexErrMsgTxt("Invalid number of elements" + where);
+  frame.put<uint32_t>(elements ? mxGetScalar(elements) : 0);
+
+  if(opcode == opReadShared) {
+    const mxArray* maxAge = field(pr_value);
+    if(!maxAge || !mxIsRealScalar(maxAge) || (mxGetScalar(maxAge) < 0)) mexErrMsgTxt("Invalid max age" + where);
+    frame.put<double>(mxGetScalar(maxAge));
   }
+  return opcode;
+}
 
-  mxArray* integralFlag = mxCreateLogicalMatrix(1, 1);
-  *mxGetPr(integralFlag) = isIntegral;
-  mxSetFieldByNumber(plhs[0], 0, 5, integralFlag);
+/**
+ * @brief Reads an array of T from the response, either inline or from a bulk segment
+ *
+ * The result is an nElements / nRows x nRows matrix, a row vector if nRows is 0.
+ */
+template<typename T>
+mxArray* getRemoteArray(mtca4u_protocol::FrameReader& response, RemoteConnection& connection, uint32_t nRows = 0) {
+  uint32_t nElements = response.get<uint32_t>();
+  std::string segment;
+  if(nElements == mtca4u_protocol::bulkMarker) {
+    segment = response.getString();
+    nElements = response.get<uint32_t>();
+  }
+  const size_t nColumns = nRows ? nElements / nRows : nElements;
+  if(nRows && (nElements % nRows != 0)) throw std::runtime_error("Malformed frame.");
 
-  mxArray* signedFlag = mxCreateLogicalMatrix(1, 1);
-  *mxGetPr(signedFlag) = isSigned;
-  mxSetFieldByNumber(plhs[0], 0, 6, signedFlag);
+  mxArray* result = mxCreateUninitNumericMatrix(nRows ? nRows : 1, nColumns, getMxClassID<T>(), mxREAL);
+  if(segment.empty()) {
+    memcpy(mxGetData(result), response.getValues<T>(nElements), nElements * sizeof(T));
+  }
+  else {
+    connection.copyBulk(segment, static_cast<char*>(mxGetData(result)), nElements * sizeof(T));
+  }
+  return result;
+}
 
-  mxSetFieldByNumber(plhs[0], 0, 7, mxCreateString(""));
+/**
+ * @brief Converts the result of a remote request into a Matlab array
+ */
+mxArray* getRemoteResult(
+    mtca4u_protocol::Opcode opcode, mtca4u_protocol::FrameReader& response, RemoteConnection& connection) {
+  using namespace mtca4u_protocol;
+  switch(opcode) {
+    case opVersion:
+      return mxCreateString(response.getString().c_str());
+    case opOpen:
+    case opRegisterSize:
+      return mxCreateDoubleScalar(response.get<uint32_t>());
+    case opRead:
+    case opReadShared:
+      return getRemoteArray<double>(response, connection);
+    case opReadRaw:
+      return getRemoteArray<int32_t>(response, connection);
+    case opReadSequence: {
+      // Channel by channel, which is the column major layout of an elements x channels matrix
+      const uint32_t nChannels = response.get<uint32_t>();
+      if(nChannels == 0) throw std::runtime_error("Malformed frame.");
+      mxArray* result = getRemoteArray<double>(response, connection);
+      const size_t nElements = mxGetNumberOfElements(result);
+      if(nElements % nChannels != 0) {
+        mxDestroyArray(result);
+        throw std::runtime_error("Malformed frame.");
+      }
+      mxSetM(result, nElements / nChannels);
+      mxSetN(result, nChannels);
+      return result;
+    }
+    default:
+      return mxCreateDoubleMatrix(0, 0, mxREAL);
+  }
 }
 
 /**
- * @brief getRegisterSize
+ * @brief Sends a batch of requests to an mtca4u_server and returns a cell array with the results
  *
+ * Parameter: connection, {{command, arguments...}, ...}
+ * All requests are sent before the responses are read, so the batch costs a
+ * single round trip. Sending and receiving are interleaved, so a large batch
+ * cannot block both ends on full socket buffers or rings. If a request
+ * fails, the remaining responses are still received and the first error is
+ * raised. If the server makes no progress within the timeout of the
+ * connection, the connection is dropped. See putRemoteRequest for the
+ * commands.
  */
-void getRegisterSize(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
-  if(nrhs < 3) mexErrMsgTxt("Not enough input arguments.");
-  if(nrhs > 3) mexWarnMsgTxt("Too many input arguments.");
+void requestRemote(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  using namespace mtca4u_protocol;
+  static const unsigned int pp_connection = 0, pp_requests = 1;
+
+  if(nrhs < 2) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 2) mexWarnMsgTxt("Too many input arguments.");
   if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
 
-  boost::shared_ptr<Device> device = getDevice(prhs[0]);
+  if(!mxIsRealScalar(prhs[pp_connection])) mexErrMsgTxt("Invalid connection handle.");
+  auto connectionIt = remoteConnectionsMap.find(size_t(mxGetScalar(prhs[pp_connection])));
+  if(connectionIt == remoteConnectionsMap.end()) mexErrMsgTxt("Connection closed.");
+  RemoteConnection& connection = *connectionIt->second;
+
+  if(!mxIsCell(prhs[pp_requests])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_requests + 1) + " input argument.");
+  const size_t nRequests = mxGetNumberOfElements(prhs[pp_requests]);
+
+  // Serialise all requests first, so an invalid request does not leave the stream half written
+  std::vector<char> output;
+  std::vector<Opcode> opcodes(nRequests);
+  const uint32_t firstRequestId = connection.nextRequestId;
+  for(size_t i = 0; i < nRequests; ++i) {
+    FrameWriter frame;
+    frame.put<uint32_t>(firstRequestId + i);
+    opcodes[i] = putRemoteRequest(
+        mxGetCell(prhs[pp_requests], i), " in request " + std::to_string(i + 1) + ".", frame);
+    const std::vector<char>& bytes = frame.getFrame();
+    output.insert(output.end(), bytes.begin(), bytes.end());
+  }
+  connection.nextRequestId += nRequests;
+  statistics.phase(phaseTransfer);
+
+  plhs[0] = mxCreateCellMatrix(mxGetM(prhs[pp_requests]), mxGetN(prhs[pp_requests]));
+  std::string firstError;
+  std::vector<char> input;
+  size_t sent = 0, received = 0, nResponses = 0;
+  const auto timeout = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(connection.timeout));
+  auto lastProgress = std::chrono::steady_clock::now();
+  auto fail = [&](const std::string& message) {
+    // The stream cannot be resynchronised, so the connection is dropped
+    remoteConnectionsMap.erase(connectionIt);
+    mexErrMsgTxt(message);
+  };
+
+  while(nResponses < nRequests) {
+    bool progress = false;
+
+    if(sent < output.size()) {
+      const ssize_t n = connection.sendSome(output.data() + sent, output.size() - sent);
+      if(n < 0) fail("Connection to the server failed.");
+      sent += n;
+      progress |= (n > 0);
+    }
 
-  if(!mxIsChar(prhs[1])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(1) + " input argument.");
-  if(!mxIsChar(prhs[2])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(2) + " input argument.");
+    {
+      input.resize(received + 65536);
+      const ssize_t n = connection.receiveSome(input.data() + received, input.size() - received);
+      if(n < 0) fail("Connection to the server failed.");
+      received += n;
+      progress |= (n > 0);
+
+      // Decode all complete frames
+      size_t position = 0;
+      while(received - position >= sizeof(uint32_t)) {
+        uint32_t length;
+        memcpy(&length, input.data() + position, sizeof(length));
+        if(length > maxFrameSize) fail("Malformed response from the server.");
+        if(received - position - sizeof(uint32_t) < length) break;
+        if(nResponses >= nRequests) fail("Unexpected response from the server.");
+
+        FrameReader response(input.data() + position + sizeof(uint32_t), length);
+        bool malformed = false;
+        try {
+          if(response.get<uint32_t>() != firstRequestId + nResponses) throw std::runtime_error("Wrong request id.");
+          if(response.get<uint8_t>() == statusOk) {
+            mxSetCell(plhs[0], nResponses, getRemoteResult(opcodes[nResponses], response, connection));
+          }
+          else if(firstError.empty()) {
+            firstError = "Request " + std::to_string(nResponses + 1) + ": " + response.getString();
+          }
+        }
+        catch(std::runtime_error&) {
+          malformed = true;
+        }
+        if(malformed) fail("Malformed response from the server.");
+        ++nResponses;
+        position += sizeof(uint32_t) + length;
+      }
+      input.erase(input.begin(), input.begin() + position);
+      received -= position;
+    }
 
-  RegisterPath moduleName(mxArrayToStdString(prhs[1]));
-  RegisterPath registerName(mxArrayToStdString(prhs[2]));
-  auto reg = device->getOneDRegisterAccessor<double>(moduleName / registerName);
+    if(progress) {
+      lastProgress = std::chrono::steady_clock::now();
+    }
+    else if(nResponses < nRequests) {
+      if(!connection.wait(sent < output.size())) fail("Connection to the server failed.");
+      if((std::chrono::steady_clock::now() - lastProgress > timeout) && !connection.isServerAlive())
+        fail("Timeout waiting for the server.");
+    }
+  }
 
-  plhs[0] = mxCreateDoubleMatrix(1, 1, mxREAL);
-  (*mxGetPr(plhs[0])) = reg.getNElements();
+  statistics.phase(phaseConversion);
+  if(!firstError.empty()) mexErrMsgTxt(firstError);
 }
 
 /**
- * @brief readRegister
+ * @brief capture
+ *
+ * Polls a trigger register in a native loop and reads a set of registers
+ * with a single TransferGroup as soon as the trigger condition is met, so
+ * the data is taken microseconds after the event instead of after a round
+ * trip through Matlab. Returns the data as cell array (see read_many), the
+ * latency in seconds from the poll which met the condition until the data
+ * has been read, and the number of polls.
  *
- * Parameter: device, module, register, [offset], [elements]
+ * Parameter: device, module, register, condition, value, {{module, register, [offset], [elements]}, ...},
+ *            [timeout], [spin], [sleep]
+ * condition is 'equal' (trigger == value), 'changed' (trigger differs from
+ * the first poll, value is ignored), 'bitmask' (all bits of value are set in
+ * the trigger) or 'threshold' (trigger >= value).
+ * The first spin polls (default 1000) are done back to back, after that the
+ * loop sleeps sleep seconds (default 1e-4) between polls. An error is raised
+ * if the condition is not met within timeout seconds (default 10).
  */
-void readRegister(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
-  static const unsigned int pp_device = 0, pp_module = 1, pp_register = 2, pp_offset = 3, pp_elements = 4;
+void capture(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  static const unsigned int pp_device = 0, pp_module = 1, pp_register = 2, pp_condition = 3, pp_value = 4,
+                            pp_specs = 5, pp_timeout = 6, pp_spin = 7, pp_sleep = 8;
+  enum Condition { equal, changed, bitmask, threshold };
 
-  if(nrhs < 3) mexErrMsgTxt("Not enough input arguments.");
-  if(nrhs > 5) mexWarnMsgTxt("To many input arguments.");
-  if(nlhs > 1) mexErrMsgTxt("To many output arguments.");
+  if(nrhs < 6) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 9) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 3) mexErrMsgTxt("Too many output arguments.");
 
   boost::shared_ptr<Device> device = getDevice(prhs[pp_device]);
+  const size_t deviceHandle = mxGetScalar(prhs[pp_device]);
 
   if(!mxIsChar(prhs[pp_module])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_module) + " input argument.");
   if(!mxIsChar(prhs[pp_register])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_register) + " input argument.");
+  if(!mxIsChar(prhs[pp_condition]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_condition) + " input argument.");
 
-  if((nrhs > pp_offset) && (!mxIsRealScalar(prhs[pp_offset]) || (mxGetScalar(prhs[pp_offset]) < 0)))
-    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_offset) + " input argument.");
-
-  if((nrhs > pp_elements) && !mxIsPositiveRealScalar(prhs[pp_elements]))
-    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_elements) + " input argument.");
-
-  // offset is optional. Use 0 if not set
-  const uint32_t offset = (nrhs > pp_offset) ? mxGetScalar(prhs[pp_offset]) : 0;
-
-  // number of elements is optional. Use 0 (=all remaining) if not set
-  const uint32_t nElements = (nrhs > pp_elements) ? mxGetScalar(prhs[pp_elements]) : 0;
+  const std::string conditionName = mxArrayToStdString(prhs[pp_condition]);
+  static const std::map<std::string, Condition> conditions = {
+      {"equal", equal}, {"changed", changed}, {"bitmask", bitmask}, {"threshold", threshold}};
+  auto conditionIt = conditions.find(conditionName);
+  if(conditionIt == conditions.end()) mexErrMsgTxt("Unknown condition '" + conditionName + "'.");
+  const Condition condition = conditionIt->second;
 
-  RegisterPath moduleName(mxArrayToStdString(prhs[pp_module]));
-  RegisterPath registerName(mxArrayToStdString(prhs[pp_register]));
-  // we get the register content as a std::vector<double>
-  auto registerContent = device->read<double>(moduleName / registerName, nElements, offset);
+  if((condition != changed) && !mxIsRealScalar(prhs[pp_value]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_value) + " input argument.");
+  const double value = (condition != changed) ? mxGetScalar(prhs[pp_value]) : 0.;
+  // 2^64 is exact as double, uint64_t(value) is only defined below it
+  const double bitmaskLimit = std::ldexp(1., 64);
+  if((condition == bitmask) && ((value < 0) || (value >= bitmaskLimit) || (value != std::floor(value))))
+    mexErrMsgTxt("The bitmask must be a non-negative integer below 2^64.");
+
+  for(unsigned int i : {pp_timeout, pp_spin, pp_sleep}) {
+    if((nrhs > i) && (!mxIsRealScalar(prhs[i]) || (mxGetScalar(prhs[i]) < 0)))
+      mexErrMsgTxt("Invalid " + getOrdinalNumerString(i) + " input argument.");
+  }
+  const double timeout = (nrhs > pp_timeout) ? mxGetScalar(prhs[pp_timeout]) : defaultCaptureTimeout;
+  const double spin = (nrhs > pp_spin) ? mxGetScalar(prhs[pp_spin]) : defaultCaptureSpin;
+  const double sleep = (nrhs > pp_sleep) ? mxGetScalar(prhs[pp_sleep]) : defaultCaptureSleep;
+
+  std::vector<RegisterSpec> specs = parseRegisterSpecs(prhs[pp_specs]);
+
+  // Everything is set up before polling, so the capture only costs the transfer
+  statistics.phase(phaseSetup);
+  auto trigger = device->getScalarRegisterAccessor<double>(
+      RegisterPath(mxArrayToStdString(prhs[pp_module])) / RegisterPath(mxArrayToStdString(prhs[pp_register])));
+  std::vector<OneDRegisterAccessor<double>> accessors;
+  accessors.reserve(specs.size());
+  TransferGroup group;
+  for(auto& spec : specs) {
+    accessors.push_back(device->getOneDRegisterAccessor<double>(spec.path, spec.nElements, spec.offset));
+    group.addAccessor(accessors.back());
+  }
 
-  // as both DeviceAccess and Matlab do their own memory allocation all we can
-  // do is memcpy :-(
-  plhs[0] = mxCreateDoubleMatrix(1, registerContent.size(), mxREAL);
-  double* plhsValue = mxGetPr(plhs[0]);
-  memcpy(plhsValue, registerContent.data(), registerContent.size() * sizeof(double));
+  statistics.phase(phaseTransfer);
+  typedef std::chrono::steady_clock Clock;
+  const auto start = Clock::now();
+  const auto sleepDuration = std::chrono::duration<double>(sleep);
+  double initialValue = 0.;
+  size_t polls = 0;
+  bool fired = false;
+  double latency = 0.;
+
+  // The device is only locked for each poll, so the native threads can use it
+  // meanwhile. The data is read under the lock of the poll which fired.
+  std::shared_ptr<std::mutex> transferMutex = findDeviceSlot(deviceHandle)->transferMutex;
+  commandDeviceLock.release();
+
+  while(true) {
+    std::unique_lock<std::mutex> lock(*transferMutex);
+    trigger.read();
+    ++polls;
+    const double triggerValue = trigger;
+    switch(condition) {
+      case equal:
+        fired = (triggerValue == value);
+        break;
+      case changed:
+        if(polls == 1) initialValue = triggerValue;
+        fired = (triggerValue != initialValue);
+        break;
+      case bitmask: {
+        // Negative values are taken as two's complement, others outside 64 bit never fire
+        const double trunc = std::trunc(triggerValue);
+        if(trunc >= 0 && trunc < bitmaskLimit)
+          fired = ((uint64_t(trunc) & uint64_t(value)) == uint64_t(value));
+        else if(trunc < 0 && trunc >= -bitmaskLimit / 2)
+          fired = ((uint64_t(int64_t(trunc)) & uint64_t(value)) == uint64_t(value));
+        else
+          fired = false;
+        break;
+      }
+      case threshold:
+        fired = (triggerValue >= value);
+        break;
+    }
+    if(fired) {
+      const auto firedTime = Clock::now();
+      group.read();
+      latency = std::chrono::duration<double>(Clock::now() - firedTime).count();
+      break;
+    }
+    lock.unlock();
+    if(std::chrono::duration<double>(Clock::now() - start).count() > timeout) break;
+    if(polls >= spin) std::this_thread::sleep_for(sleepDuration);
+  }
+  if(!fired) mexErrMsgTxt("Capture trigger condition not met within the timeout (" + std::to_string(polls) + " polls).");
+
+  statistics.phase(phaseConversion);
+  plhs[0] = mxCreateCellMatrix(mxGetM(prhs[pp_specs]), mxGetN(prhs[pp_specs]));
+  for(size_t i = 0; i < accessors.size(); ++i) {
+    mxArray* data = mxCreateUninitNumericMatrix(1, accessors[i].getNElements(), mxDOUBLE_CLASS, mxREAL);
+    memcpy(mxGetData(data), accessors[i].data(), accessors[i].getNElements() * sizeof(double));
+    mxSetCell(plhs[0], i, data);
+    statistics.addBytes(specs[i].path, accessors[i].getNElements() * sizeof(double));
+  }
+  if(nlhs > 1) plhs[1] = mxCreateDoubleScalar(latency);
+  if(nlhs > 2) plhs[2] = mxCreateDoubleScalar(polls);
 }
 
 /**
- * @brief writeRegister
+ * @brief writeMany
  *
- * Parameter: device, module, register, value, [offset]
+ * Writes a list of registers with a single TransferGroup, so adjacent areas
+ * are merged into as few transfers as the backend allows. With verify set,
+ * all registers are read back in a second TransferGroup and compared with
+ * the written values after the conversion to double.
+ *
+ * Parameter: device, {{module, register, value, [offset]}, ...}, [verify]
+ * Returns a struct array with one entry per register and the fields
+ * register, mismatches (number of differing elements), indices (1-based
+ * elements which differ) and readback (the values read back). The struct
+ * array is empty if verify is not set.
  */
-void writeRegister(unsigned int, mxArray**, unsigned int nrhs, const mxArray* prhs[]) {
-  static const unsigned int pp_device = 0, pp_module = 1, pp_register = 2, pp_value = 3, pp_offset = 4;
+void writeMany(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  static const unsigned int pp_device = 0, pp_specs = 1, pp_verify = 2;
+  static const unsigned int ps_module = 0, ps_register = 1, ps_value = 2, ps_offset = 3;
 
-  if(nrhs < 4) mexErrMsgTxt("Not enough input arguments.");
-  if(nrhs > 5) mexWarnMsgTxt("To many input arguments.");
+  if(nrhs < 2) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 3) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
 
   boost::shared_ptr<Device> device = getDevice(prhs[pp_device]);
 
-  if(!mxIsChar(prhs[pp_module])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_module) + " input argument.");
-  if(!mxIsChar(prhs[pp_register])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_register) + " input argument.");
-
-  if(!mxIsNumeric(prhs[pp_value]) || mxIsComplex(prhs[pp_value]))
-    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_value) + " input argument.");
+  const mxArray* prhsSpecs = prhs[pp_specs];
+  if(!mxIsCell(prhsSpecs)) mexErrMsgTxt("Register specs must be a cell array.");
+  if((nrhs > pp_verify) && !mxIsRealScalar(prhs[pp_verify]) && !mxIsLogicalScalar(prhs[pp_verify]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_verify + 1) + " input argument.");
+  const bool verify = (nrhs > pp_verify) && mxGetBoolScalar(prhs[pp_verify]);
+
+  // Parse everything before the first transfer, so an invalid spec does not leave a partial write
+  const size_t nSpecs = mxGetNumberOfElements(prhsSpecs);
+  std::vector<RegisterPath> paths(nSpecs);
+  std::vector<const mxArray*> values(nSpecs);
+  std::vector<uint32_t> offsets(nSpecs);
+  for(size_t i = 0; i < nSpecs; ++i) {
+    const mxArray* spec = mxGetCell(prhsSpecs, i);
+    const std::string where = " in register spec " + std::to_string(i + 1) + ".";
+
+    if(!spec || !mxIsCell(spec)) mexErrMsgTxt("Invalid register spec " + std::to_string(i + 1) + ".");
+    const size_t nFields = mxGetNumberOfElements(spec);
+    if(nFields < 3 || nFields > 4) mexErrMsgTxt("Invalid number of entries" + where);
+
+    const mxArray* module = mxGetCell(spec, ps_module);
+    const mxArray* reg = mxGetCell(spec, ps_register);
+    if(!module || !mxIsChar(module)) mexErrMsgTxt("Invalid module name" + where);
+    if(!reg || !mxIsChar(reg)) mexErrMsgTxt("Invalid register name" + where);
+    paths[i] = RegisterPath(mxArrayToStdString(module)) / RegisterPath(mxArrayToStdString(reg));
+
+    values[i] = mxGetCell(spec, ps_value);
+    if(!values[i] || (!mxIsNumeric(values[i]) && !mxIsLogical(values[i])) || mxIsComplex(values[i]) ||
+        mxIsEmpty(values[i]))
+      mexErrMsgTxt("Invalid value" + where);
+
+    const mxArray* offset = (nFields > ps_offset) ? mxGetCell(spec, ps_offset) : NULL;
+    if(offset && (!mxIsRealScalar(offset) || (mxGetScalar(offset) < 0))) mexErrMsgTxt("Invalid offset" + where);
+    offsets[i] = offset ? mxGetScalar(offset) : 0;
+  }
 
-  if((nrhs > pp_offset) && (!mxIsRealScalar(prhs[pp_offset]) || (mxGetScalar(prhs[pp_offset]) < 0)))
-    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_offset) + " input argument.");
+  statistics.phase(phaseSetup);
+  std::vector<OneDRegisterAccessor<double>> accessors;
+  accessors.reserve(nSpecs);
+  TransferGroup writeGroup;
+  for(size_t i = 0; i < nSpecs; ++i) {
+    accessors.push_back(device->getOneDRegisterAccessor<double>(paths[i], mxGetNumberOfElements(values[i]), offsets[i]));
+    writeGroup.addAccessor(accessors.back());
+  }
 
-  mxClassID arrayType = mxGetClassID(prhs[pp_value]);
-  size_t prhsValueElements = mxGetNumberOfElements(prhs[pp_value]);
-  void* data = mxGetData(prhs[pp_value]);
+  statistics.phase(phaseConversion);
+  for(size_t i = 0; i < nSpecs; ++i) copyFromMxArray(values[i], accessors[i].data(), accessors[i].getNElements());
 
-  const uint32_t offset = (nrhs > pp_offset) ? mxGetScalar(prhs[pp_offset]) : 0;
-  std::string registerPath = mxArrayToStdString(prhs[pp_module]) + '/' + mxArrayToStdString(prhs[pp_register]);
+  statistics.phase(phaseTransfer);
+  writeGroup.write();
+  for(size_t i = 0; i < nSpecs; ++i) statistics.addBytes(paths[i], accessors[i].getNElements() * sizeof(double));
 
-  // TODO: Extract this to a method if this has to be used else where
-  if(arrayType == mxDOUBLE_CLASS) {
-    writeToDevice<double>(device, registerPath, data, prhsValueElements, offset);
-  }
-  else if(arrayType == mxUINT8_CLASS) {
-    writeToDevice<uint8_t>(device, registerPath, data, prhsValueElements, offset);
-  }
-  else if(arrayType == mxINT8_CLASS) {
-    writeToDevice<int8_t>(device, registerPath, data, prhsValueElements, offset);
-  }
-  else if(arrayType == mxINT16_CLASS) {
-    writeToDevice<int16_t>(device, registerPath, data, prhsValueElements, offset);
-  }
-  else if(arrayType == mxUINT16_CLASS) {
-    writeToDevice<uint16_t>(device, registerPath, data, prhsValueElements, offset);
+  const char* reportFields[] = {"register", "mismatches", "indices", "readback"};
+  if(!verify) {
+    if(nlhs > 0) plhs[0] = mxCreateStructMatrix(0, 0, 4, reportFields);
+    return;
   }
-  else if(arrayType == mxINT32_CLASS) {
-    writeToDevice<int32_t>(device, registerPath, data, prhsValueElements, offset);
+
+  // Separate accessors, so the written values stay in the buffers of the first ones for the comparison
+  statistics.phase(phaseSetup);
+  std::vector<OneDRegisterAccessor<double>> readbackAccessors;
+  readbackAccessors.reserve(nSpecs);
+  TransferGroup readGroup;
+  for(size_t i = 0; i < nSpecs; ++i) {
+    readbackAccessors.push_back(device->getOneDRegisterAccessor<double>(paths[i], accessors[i].getNElements(), offsets[i]));
+    readGroup.addAccessor(readbackAccessors.back());
   }
-  else if(arrayType == mxUINT32_CLASS) {
-    writeToDevice<uint32_t>(device, registerPath, data, prhsValueElements, offset);
+  statistics.phase(phaseTransfer);
+  readGroup.read();
+
+  statistics.phase(phaseConversion);
+  plhs[0] = mxCreateStructMatrix(nSpecs, 1, 4, reportFields);
+  for(size_t i = 0; i < nSpecs; ++i) {
+    const size_t nElements = accessors[i].getNElements();
+    std::vector<double> indices;
+    for(size_t j = 0; j < nElements; ++j) {
+      if(readbackAccessors[i][j] != accessors[i][j]) indices.push_back(j + 1);
+    }
+    mxArray* indicesArray = mxCreateDoubleMatrix(1, indices.size(), mxREAL);
+    std::copy(indices.begin(), indices.end(), mxGetPr(indicesArray));
+    mxArray* readback = mxCreateUninitNumericMatrix(1, nElements, mxDOUBLE_CLASS, mxREAL);
+    memcpy(mxGetData(readback), readbackAccessors[i].data(), nElements * sizeof(double));
+
+    mxSetField(plhs[0], i, "register", mxCreateString(std::string(paths[i]).c_str()));
+    mxSetField(plhs[0], i, "mismatches", mxCreateDoubleScalar(indices.size()));
+    mxSetField(plhs[0], i, "indices", indicesArray);
+    mxSetField(plhs[0], i, "readback", readback);
   }
-  else if(arrayType == mxINT64_CLASS) {
-    writeToDevice<int64_t>(device, registerPath, data, prhsValueElements, offset);
+}
+
+void WorkerPool::submit(std::function<void()> task) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if(threads.empty()) {
+    stopping = false;
+    for(size_t i = 0; i < nThreads; ++i) threads.emplace_back(&WorkerPool::run, this);
   }
-  else if(arrayType == mxUINT64_CLASS) {
-    writeToDevice<uint64_t>(device, registerPath, data, prhsValueElements, offset);
+  tasks.push_back(std::move(task));
+  wake.notify_one();
+}
+
+void WorkerPool::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
   }
-  else {
-    mexErrMsgTxt("Data type unsupported.");
+  wake.notify_all();
+  for(auto& thread : threads) thread.join();
+  threads.clear();
+}
+
+void WorkerPool::run() {
+  while(true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [this] { return stopping || !tasks.empty(); });
+      if(tasks.empty()) return;
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    task();
   }
 }
 
 /**
- * @brief readRawDmaData
+ * @brief readMultiDevice
  *
- * Parameter: device, module, register, [offset], [elements], [mode], [singed],
- * [bit], [fracbit]
+ * Reads the same register from several devices concurrently on the worker
+ * pool. Handles sharing one opened device are read one after the other by
+ * the same task, as a backend may not be used from several threads at once.
+ *
+ * Parameter: devices, module, register, [offset], [elements]
+ * devices is a vector of device handles. Returns an elements x devices
+ * matrix.
  */
-void readDmaRaw(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
-  static const unsigned int pp_device = 0, pp_module = 1, pp_register = 2, pp_offset = 3, pp_elements = 4;
-  static const unsigned int pp_mode = 5, pp_signed = 6, pp_bit = 7, pp_fracbit = 8;
+void readMultiDevice(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  static const unsigned int pp_devices = 0, pp_module = 1, pp_register = 2, pp_offset = 3, pp_elements = 4;
 
   if(nrhs < 3) mexErrMsgTxt("Not enough input arguments.");
-  if(nrhs > 9) mexWarnMsgTxt("Too many input arguments.");
+  if(nrhs > 5) mexWarnMsgTxt("Too many input arguments.");
   if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
 
-  boost::shared_ptr<Device> device = getDevice(prhs[pp_device]);
-
-  if(!mxIsChar(prhs[pp_module])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_module) + " input argument.");
-  if(!mxIsChar(prhs[pp_register])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_register) + " input argument.");
-
-  if((nrhs > pp_offset) && !mxIsRealScalar(prhs[pp_offset]))
-    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_offset) + " input argument.");
+  if(!mxIsRealVector(prhs[pp_devices]) || mxIsEmpty(prhs[pp_devices]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_devices + 1) + " input argument.");
+  if(!mxIsChar(prhs[pp_module])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_module + 1) + " input argument.");
+  if(!mxIsChar(prhs[pp_register]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_register + 1) + " input argument.");
+  if((nrhs > pp_offset) && (!mxIsRealScalar(prhs[pp_offset]) || (mxGetScalar(prhs[pp_offset]) < 0)))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_offset + 1) + " input argument.");
   if((nrhs > pp_elements) && !mxIsPositiveRealScalar(prhs[pp_elements]))
-    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_elements) + " input argument.");
-
-  if((nrhs > pp_mode) && !mxIsPositiveRealScalar(prhs[pp_mode]))
-    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_mode) + " input argument.");
-
-  // FIXME: These don't make sense in raw mode. Shall we just skip the checks?
-  // They are not used anyway.
-  if((nrhs > pp_signed) && !mxIsRealScalar(prhs[pp_signed]))
-    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_signed) + " input argument.");
-  if((nrhs > pp_bit) && !mxIsPositiveRealScalar(prhs[pp_bit]))
-    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_bit) + " input argument.");
-  if((nrhs > pp_fracbit) && !mxIsRealScalar(prhs[pp_fracbit]))
-    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_fracbit) + " input argument.");
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_elements + 1) + " input argument.");
 
-  // offset is optional. Use 0 if not set
   const uint32_t offset = (nrhs > pp_offset) ? mxGetScalar(prhs[pp_offset]) : 0;
-  // number of elements is optional. Use 0 (=all remaining) if not set
-  const uint32_t nElements = (nrhs > pp_elements) ? mxGetScalar(prhs[pp_elements]) : 0;
-
-  // The mode can be 16 or 32 bit. This does not make sense because the real raw
-  // stuff is 32 bits, it was there so we keep it in order not to break
-  // compatibility.
-  const uint32_t mode = (nrhs > pp_mode) ? mxGetScalar(prhs[pp_mode]) : 32;
-  if((mode != 32) && (mode != 16)) mexErrMsgTxt("Invalid data mode.");
-
-  // Number of 32 bit words to read through the "bus". This currently is the
-  // only mode the raw accessor knows
-  uint32_t nWords32Bit = nElements;
-  if(mode == 16) {
-    // The number of 32 bit words is only half the number of elements if the are
-    // requested as 16 bit
-    nWords32Bit /= 2;
+  const uint32_t nRequested = (nrhs > pp_elements) ? mxGetScalar(prhs[pp_elements]) : 0;
+  const RegisterPath registerPath =
+      RegisterPath(mxArrayToStdString(prhs[pp_module])) / RegisterPath(mxArrayToStdString(prhs[pp_register]));
+
+  const size_t nDevices = mxGetNumberOfElements(prhs[pp_devices]);
+  std::vector<double> handles(nDevices);
+  copyFromMxArray(prhs[pp_devices], handles.data(), nDevices);
+
+  // Columns grouped by the transfer mutex of the opened device, see above
+  std::map<std::shared_ptr<std::mutex>, std::vector<size_t>> columnsByDevice;
+  std::vector<DeviceSlot*> slots(nDevices);
+  for(size_t i = 0; i < nDevices; ++i) {
+    slots[i] = (handles[i] >= 0) ? findDeviceSlot(size_t(handles[i])) : NULL;
+    if(!slots[i]) mexErrMsgTxt("Invalid or closed device handle at position " + std::to_string(i + 1) + ".");
+    columnsByDevice[slots[i]->transferMutex].push_back(i);
   }
 
-  // Notice: signedFlags, bits and fracBits have been removed as they were
-  // not/cannot be used anyway
-
-  // Now that we have all parameters it's time to read the data from the device.
-  RegisterPath registerPath(mxArrayToStdString(prhs[pp_module]) + "/" + mxArrayToStdString(prhs[pp_register]));
-
-  // we get the register content as a std::vector<double>
-  auto accessor = device->getOneDRegisterAccessor<int32_t>(registerPath, nWords32Bit, offset, {AccessMode::raw});
-  accessor.read();
-
-  // frame matlab buffer with appropriate number of elements
-  auto bufferSize = (mode == 16) ? accessor.getNElements() * 2 : accessor.getNElements();
-  plhs[0] = mxCreateDoubleMatrix(bufferSize, 1, mxREAL);
-
-  double* plhsValue = mxGetPr(plhs[0]);
+  statistics.phase(phaseSetup);
+  std::vector<OneDRegisterAccessor<double>> accessors;
+  accessors.reserve(nDevices);
+  for(size_t i = 0; i < nDevices; ++i) {
+    commandDeviceLock.lock(slots[i]->transferMutex);
+    accessors.push_back(slots[i]->device->getOneDRegisterAccessor<double>(registerPath, nRequested, offset));
+    if(accessors[i].getNElements() != accessors[0].getNElements())
+      mexErrMsgTxt("Register size differs at position " + std::to_string(i + 1) + ".");
+  }
+  const size_t nElements = accessors[0].getNElements();
+  commandDeviceLock.release();
+
+  plhs[0] = mxCreateUninitNumericMatrix(nElements, nDevices, mxDOUBLE_CLASS, mxREAL);
+  double* data = mxGetPr(plhs[0]);
+
+  statistics.phase(phaseTransfer);
+  std::vector<std::string> errors(nDevices);
+  std::mutex doneMutex;
+  std::condition_variable done;
+  size_t remaining = columnsByDevice.size();
+  for(auto& group : columnsByDevice) {
+    std::mutex* transferMutex = group.first.get();
+    const std::vector<size_t>* columns = &group.second;
+    workerPool.submit([&, transferMutex, columns] {
+      std::unique_lock<std::mutex> deviceLock(*transferMutex);
+      for(size_t column : *columns) {
+        try {
+          accessors[column].read();
+          memcpy(data + column * nElements, accessors[column].data(), nElements * sizeof(double));
+        }
+        catch(std::exception& e) {
+          errors[column] = e.what();
+        }
+      }
+      deviceLock.unlock();
+      std::lock_guard<std::mutex> lock(doneMutex);
+      if(--remaining == 0) done.notify_one();
+    });
+  }
+  {
+    std::unique_lock<std::mutex> lock(doneMutex);
+    done.wait(lock, [&] { return remaining == 0; });
+  }
 
-  if(mode == 32) {
-    size_t i = 0;
-    // we can directly loop the accessor
-    for(auto value : accessor) {
-      plhsValue[i++] = value;
+  for(size_t i = 0; i < nDevices; ++i) {
+    if(!errors[i].empty()) {
+      mxDestroyArray(plhs[0]);
+      plhs[0] = NULL;
+      mexErrMsgTxt("Device at position " + std::to_string(i + 1) + ": " + errors[i]);
     }
   }
-  else {
-    auto values16Bit = reinterpret_cast<int16_t*>(accessor.data());
-    for(size_t i = 0; i < bufferSize; ++i) {
-      plhsValue[i] = values16Bit[i];
-    }
+  for(size_t i = 0; i < nDevices; ++i) {
+    statistics.setDevice(size_t(handles[i]));
+    statistics.addBytes(registerPath, nElements * sizeof(double));
   }
 }
 
 /**
- * @brief readSequence
+ * @brief readAsync
+ *
+ * Starts a read on the worker pool and returns a ticket immediately, so
+ * Matlab can work on the previous data while the transfer is running. The
+ * transfers of one device are done one after the other in the order of the
+ * calls, and other commands on the device wait for a running transfer.
  *
- * Parameter: device, module, register, [channel], [offset], [elements]
+ * Parameter: command, device, module, register, [offset], [elements]
+ * command is 'read' (1xN double), 'read_raw' (1xN int32 raw words) or
+ * 'read_seq' (elements x channels double, offset and elements per channel).
  */
-void readSequence(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
-  static const unsigned int pp_device = 0, pp_module = 1, pp_register = 2, pp_channel = 3, pp_offset = 4,
+void readAsync(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  static const unsigned int pp_command = 0, pp_device = 1, pp_module = 2, pp_register = 3, pp_offset = 4,
                             pp_elements = 5;
 
-  if(nrhs < 3) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs < 4) mexErrMsgTxt("Not enough input arguments.");
   if(nrhs > 6) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
 
-  /*if (mxGetScalar(prhs[pp_channel]) == 0)
-    mexErrMsgTxt("channel index cannot be 0.");*/
+  if(!mxIsChar(prhs[pp_command])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_command + 1) + " input argument.");
+  const std::string command = mxArrayToStdString(prhs[pp_command]);
+  if((command != "read") && (command != "read_raw") && (command != "read_seq"))
+    mexErrMsgTxt("Unknown read command '" + command + "'. Use 'read', 'read_raw' or 'read_seq'.");
 
   boost::shared_ptr<Device> device = getDevice(prhs[pp_device]);
+  const size_t deviceHandle = mxGetScalar(prhs[pp_device]);
 
-  if(!mxIsChar(prhs[pp_module])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_module) + " input argument.");
-  if(!mxIsChar(prhs[pp_register])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_register) + " input argument.");
-
-  if((nrhs > pp_channel) && !mxIsPositiveRealVector(prhs[pp_channel]))
-    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_channel) + " input argument.");
-
-  if((nlhs > 1) && !(nrhs > pp_channel)) mexErrMsgTxt("Not enough input arguments.");
-  if((nlhs > 1) && (nrhs > pp_channel) && (nlhs > mxGetNumberOfElements(prhs[pp_channel])))
-    mexErrMsgTxt("Too many output arguments.");
-  if((nlhs > 1) && (nrhs > pp_channel) && (nlhs < mxGetNumberOfElements(prhs[pp_channel])))
-    mexErrMsgTxt("Not enough output arguments.");
-
-  if((nrhs > pp_offset) && !mxIsRealScalar(prhs[pp_offset]))
-    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_offset) + " input argument.");
+  if(!mxIsChar(prhs[pp_module])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_module + 1) + " input argument.");
+  if(!mxIsChar(prhs[pp_register]))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_register + 1) + " input argument.");
+  if((nrhs > pp_offset) && (!mxIsRealScalar(prhs[pp_offset]) || (mxGetScalar(prhs[pp_offset]) < 0)))
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_offset + 1) + " input argument.");
   if((nrhs > pp_elements) && !mxIsPositiveRealScalar(prhs[pp_elements]))
-    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_elements) + " input argument.");
-
-  auto twoDRegister = device->getTwoDRegisterAccessor<double>(
-      mxArrayToStdString(prhs[pp_module]) + "/" + mxArrayToStdString(prhs[pp_register]));
-  twoDRegister.read();
+    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_elements + 1) + " input argument.");
 
   const uint32_t offset = (nrhs > pp_offset) ? mxGetScalar(prhs[pp_offset]) : 0;
-  const uint32_t elements = (nrhs > pp_elements) ? mxGetScalar(prhs[pp_elements]) : (twoDRegister[0].size());
-
-  const uint32_t totalChannels = twoDRegister.getNChannels();
-
-  /*if (mxGetScalar(prhs[pp_channel]) > totalChannels)
-    mexErrMsgTxt("Requested Channel Index greater than available channels");*/
-
-  const uint32_t size = elements * totalChannels;
-  std::vector<double> dmaValue(size);
+  const uint32_t nElements = (nrhs > pp_elements) ? mxGetScalar(prhs[pp_elements]) : 0;
 
-  unsigned int selectedChannels = (nrhs > pp_channel) ? mxGetNumberOfElements(prhs[pp_channel]) : totalChannels;
-  // Store data in different vectors passed over lhs
-  if(nlhs == selectedChannels) {
-    for(unsigned int ic = 0; ic < nlhs; ic++) {
-      plhs[ic] = mxCreateDoubleMatrix(elements, 1, mxREAL);
-      double* plhsValue = mxGetPr(plhs[ic]);
-      unsigned int currentChannel = (nrhs > pp_channel) ? (mxGetPr(prhs[pp_channel])[ic] - 1) : ic;
-
-      for(unsigned int is = 0; is < elements; is++) {
-        unsigned int seqIndex = (is + offset);
-        if(seqIndex >= size) mexErrMsgTxt("Data storage indexing went wrong!");
-        plhsValue[is] = twoDRegister[currentChannel][seqIndex];
-      }
-    }
+  auto ticket = std::make_shared<ReadTicket>();
+  ticket->deviceHandle = deviceHandle;
+  ticket->registerPath =
+      RegisterPath(mxArrayToStdString(prhs[pp_module])) / RegisterPath(mxArrayToStdString(prhs[pp_register]));
+
+  // Copies of an accessor share its buffer, so each lambda gets its own copy
+  statistics.phase(phaseSetup);
+  if(command == "read_seq") {
+    auto accessor = device->getTwoDRegisterAccessor<double>(ticket->registerPath, nElements, offset);
+    ticket->nBytes = accessor.getNChannels() * accessor.getNElementsPerChannel() * sizeof(double);
+    ticket->transfer = [accessor]() mutable { accessor.read(); };
+    ticket->convert = [accessor]() mutable {
+      const size_t nChannelElements = accessor.getNElementsPerChannel();
+      mxArray* value = mxCreateUninitNumericMatrix(nChannelElements, accessor.getNChannels(), mxDOUBLE_CLASS, mxREAL);
+      for(size_t ic = 0; ic < accessor.getNChannels(); ++ic)
+        memcpy(mxGetPr(value) + ic * nChannelElements, accessor[ic].data(), nChannelElements * sizeof(double));
+      return value;
+    };
+  }
+  else if(command == "read_raw") {
+    auto accessor = device->getOneDRegisterAccessor<int32_t>(ticket->registerPath, nElements, offset, {AccessMode::raw});
+    ticket->nBytes = accessor.getNElements() * sizeof(int32_t);
+    ticket->transfer = [accessor]() mutable { accessor.read(); };
+    ticket->convert = [accessor]() mutable {
+      mxArray* value = mxCreateUninitNumericMatrix(1, accessor.getNElements(), mxINT32_CLASS, mxREAL);
+      memcpy(mxGetData(value), accessor.data(), accessor.getNElements() * sizeof(int32_t));
+      return value;
+    };
   }
-  // Store data in lhs matrix
   else {
-    plhs[0] = mxCreateDoubleMatrix(elements, selectedChannels, mxREAL);
-    double* plhsValue = mxGetPr(plhs[0]);
-
-    // copy and transform data
-    for(unsigned int ic = 0; ic < selectedChannels; ic++) {
-      int currentChannel = (nrhs > pp_channel) ? (mxGetPr(prhs[pp_channel])[ic] - 1) : ic;
-
-      if(currentChannel < 0 || uint32_t(currentChannel) >= totalChannels) mexErrMsgTxt("Illegal Channel Index");
-
-      for(unsigned int is = 0; is < elements; is++) {
-        unsigned int plhsIndex = ic * elements + is;
-        unsigned int seqIndex = (is + offset);
-
-        if(seqIndex >= size) mexErrMsgTxt("Data storage indexing went wrong! (1)");
-        if(plhsIndex >= elements * selectedChannels) mexErrMsgTxt("Data storage indexing went wrong! (2)");
+    auto accessor = device->getOneDRegisterAccessor<double>(ticket->registerPath, nElements, offset);
+    ticket->nBytes = accessor.getNElements() * sizeof(double);
+    ticket->transfer = [accessor]() mutable { accessor.read(); };
+    ticket->convert = [accessor]() mutable {
+      mxArray* value = mxCreateUninitNumericMatrix(1, accessor.getNElements(), mxDOUBLE_CLASS, mxREAL);
+      memcpy(mxGetData(value), accessor.data(), accessor.getNElements() * sizeof(double));
+      return value;
+    };
+  }
 
-        plhsValue[plhsIndex] = twoDRegister[currentChannel][seqIndex];
+  std::shared_ptr<std::mutex> transferMutex = findDeviceSlot(deviceHandle)->transferMutex;
+  workerPool.submit([ticket, transferMutex] {
+    std::string error;
+    {
+      std::lock_guard<std::mutex> deviceLock(*transferMutex);
+      try {
+        ticket->transfer();
+      }
+      catch(std::exception& e) {
+        error = e.what();
       }
     }
-  }
+    std::lock_guard<std::mutex> lock(ticket->mutex);
+    ticket->error = error;
+    ticket->finished = true;
+    ticket->finishedCondition.notify_all();
+  });
+
+  readTicketsMap[nextReadTicket] = ticket;
+  plhs[0] = mxCreateDoubleScalar(nextReadTicket++);
 }
 
-void readRaw(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
-  static const unsigned int pp_device = 0, pp_module = 1, pp_register = 2, pp_offset = 3, pp_elements = 4;
+/**
+ * @brief Returns the ticket given as parameter, raises an error if it does not exist
+ */
+std::shared_ptr<ReadTicket> getReadTicket(const mxArray* prhsTicket) {
+  if(!mxIsRealScalar(prhsTicket)) mexErrMsgTxt("Invalid read ticket.");
+  auto it = readTicketsMap.find(size_t(mxGetScalar(prhsTicket)));
+  if(it == readTicketsMap.end()) mexErrMsgTxt("Invalid read ticket.");
+  return it->second;
+}
 
-  if(nrhs < 3) mexErrMsgTxt("Not enough input arguments.");
-  if(nrhs > 5) mexWarnMsgTxt("Too many input arguments.");
+/**
+ * @brief readReady
+ *
+ * Returns true if the transfer of a ticket has finished (also if it failed),
+ * so read_fetch will not block.
+ *
+ * Parameter: ticket
+ */
+void readReady(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  if(nrhs < 1) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 1) mexWarnMsgTxt("Too many input arguments.");
   if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
 
-  auto device = getDevice(prhs[pp_device]);
-
-  if(!mxIsChar(prhs[pp_module])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_module) + " input argument.");
-  if(!mxIsChar(prhs[pp_register])) mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_register) + " input argument.");
-
-  if((nrhs > pp_offset) && !mxIsRealScalar(prhs[pp_offset])) {
-    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_offset) + " input argument.");
-  }
-  if((nrhs > pp_elements) && !mxIsPositiveRealScalar(prhs[pp_elements])) {
-    mexErrMsgTxt("Invalid " + getOrdinalNumerString(pp_elements) + " input argument.");
-  }
+  std::shared_ptr<ReadTicket> ticket = getReadTicket(prhs[0]);
+  std::lock_guard<std::mutex> lock(ticket->mutex);
+  plhs[0] = mxCreateLogicalScalar(ticket->finished);
+}
 
-  // offset, nElements is optional. Use 0 if not set; nElements = 0 =>
-  // read all elements.
-  const uint32_t offset = (nrhs > pp_offset) ? mxGetScalar(prhs[pp_offset]) : 0;
-  const uint32_t nElements = (nrhs > pp_elements) ? mxGetScalar(prhs[pp_elements]) : 0;
+/**
+ * @brief readFetch
+ *
+ * Waits for the transfer of a ticket and returns the data. The ticket is
+ * released, also if the transfer has failed.
+ *
+ * Parameter: ticket
+ */
+void readFetch(unsigned int nlhs, mxArray* plhs[], unsigned int nrhs, const mxArray* prhs[]) {
+  if(nrhs < 1) mexErrMsgTxt("Not enough input arguments.");
+  if(nrhs > 1) mexWarnMsgTxt("Too many input arguments.");
+  if(nlhs > 1) mexErrMsgTxt("Too many output arguments.");
 
-  RegisterPath registerPath(mxArrayToStdString(prhs[pp_module]) + "/" + mxArrayToStdString(prhs[pp_register]));
-  auto accessor = device->getOneDRegisterAccessor<int32_t>(registerPath, nElements, offset, {AccessMode::raw});
-  accessor.read();
+  std::shared_ptr<ReadTicket> ticket = getReadTicket(prhs[0]);
+  readTicketsMap.erase(size_t(mxGetScalar(prhs[0])));
+  statistics.setDevice(ticket->deviceHandle);
 
-  // frame matlab buffer with appropriate number of elements
-  plhs[0] = mxCreateUninitNumericMatrix(1, accessor.getNElements(), mxINT32_CLASS, mxREAL);
-  int32_t* plhsValue = reinterpret_cast<int32_t*>(mxGetData(plhs[0]));
+  statistics.phase(phaseTransfer);
+  {
+    std::unique_lock<std::mutex> lock(ticket->mutex);
+    ticket->finishedCondition.wait(lock, [&] { return ticket->finished; });
+  }
+  if(!ticket->error.empty()) mexErrMsgTxt(ticket->error);
 
-  memcpy(plhsValue, accessor.data(), accessor.getNElements() * sizeof(uint32_t));
+  statistics.phase(phaseConversion);
+  plhs[0] = ticket->convert();
+  statistics.addBytes(ticket->registerPath, ticket->nBytes);
 }
 
-template<typename UserType>
-void writeToDevice(boost::shared_ptr<Device>& device, const std::string& registerPath, void* data_,
-    size_t numberOfwords, size_t offset) {
-  auto data = static_cast<UserType*>(data_);
-  auto accessor = device->getOneDRegisterAccessor<UserType>(registerPath, numberOfwords, offset);
-
-  for(unsigned int i = 0; i < numberOfwords; ++i) {
-    accessor[i] = data[i];
+/**
+ * @brief Waits for the transfers of all tickets of a device handle and releases them
+ */
+void releaseReadTickets(size_t deviceHandle) {
+  for(auto it = readTicketsMap.begin(); it != readTicketsMap.end();) {
+    if(it->second->deviceHandle == deviceHandle) {
+      std::unique_lock<std::mutex> lock(it->second->mutex);
+      it->second->finishedCondition.wait(lock, [&] { return it->second->finished; });
+      lock.unlock();
+      it = readTicketsMap.erase(it);
+    }
+    else
+      ++it;
   }
-  accessor.write();
 }
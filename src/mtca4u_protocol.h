@@ -0,0 +1,298 @@
+/**
+ * @file mtca4u_protocol.h
+ *
+ * @brief Binary protocol between mtca4u_server and the remote client in the mex file
+ *
+ * Each message is a frame of a uint32 length followed by that many bytes.
+ * A request frame holds the request id (uint32), the opcode (uint8) and the
+ * arguments. The response frame holds the request id, the status (uint8) and
+ * the result, or the error message if the status is not ok. Several requests
+ * may be sent before reading the responses, which come back in the same order.
+ *
+ * Integers and doubles are in host byte order, as both ends are expected to
+ * run on little endian machines. Strings are a uint32 length followed by the
+ * characters. Arrays are a uint32 number of elements followed by the values.
+ * Over shared memory (see mtca4u_shm.h) the array of a shared read is instead
+ * sent as bulkMarker, the name of the shared segment holding it and the
+ * number of elements.
+ */
+
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace mtca4u_protocol {
+
+  enum Opcode : uint8_t {
+    opVersion = 1,      // -> string
+    opOpen = 2,         // alias -> uint32 device
+    opClose = 3,        // device ->
+    opRead = 4,         // device, path, uint32 offset, uint32 elements -> double array
+    opWrite = 5,        // device, path, uint32 offset, double array ->
+    opReadRaw = 6,      // device, path, uint32 offset, uint32 elements -> int32 array
+    opReadSequence = 7, // device, path -> uint32 channels, double array (channel by channel)
+    opRegisterSize = 8, // device, path -> uint32
+    opReadShared = 9    // device, path, uint32 offset, uint32 elements, double max age -> double array
+  };
+
+  enum Status : uint8_t { statusOk = 0, statusError = 1 };
+
+  // Frames are limited to protect the peer from corrupted length fields
+  const uint32_t maxFrameSize = 1u << 30;
+
+  // Number of elements announcing an array in a shared segment
+  const uint32_t bulkMarker = 0xFFFFFFFFu;
+
+  /**
+   * @brief Serialises the payload of a frame, the length is filled in by getFrame()
+   */
+  class FrameWriter {
+   public:
+    FrameWriter() : buffer(sizeof(uint32_t)) {}
+
+    template<typename T>
+    void put(T value) {
+      const char* p = reinterpret_cast<const char*>(&value);
+      buffer.insert(buffer.end(), p, p + sizeof(T));
+    }
+
+    void putString(const std::string& value) {
+      put<uint32_t>(value.size());
+      buffer.insert(buffer.end(), value.begin(), value.end());
+    }
+
+    template<typename T>
+    void putArray(const T* values, size_t nElements) {
+      put<uint32_t>(nElements);
+      const char* p = reinterpret_cast<const char*>(values);
+      buffer.insert(buffer.end(), p, p + nElements * sizeof(T));
+    }
+
+    /// Reserves space for an array and returns a pointer to it, valid until the next put
+    template<typename T>
+    T* putArray(size_t nElements) {
+      put<uint32_t>(nElements);
+      const size_t position = buffer.size();
+      buffer.resize(position + nElements * sizeof(T));
+      return reinterpret_cast<T*>(buffer.data() + position);
+    }
+
+    const std::vector<char>& getFrame() {
+      const uint32_t length = buffer.size() - sizeof(uint32_t);
+      memcpy(buffer.data(), &length, sizeof(length));
+      return buffer;
+    }
+
+   private:
+    std::vector<char> buffer;
+  };
+
+  /**
+   * @brief Reads the payload of a frame, throws std::runtime_error if it is too short
+   */
+  class FrameReader {
+   public:
+    FrameReader(const char* data, size_t size) : position(data), end(data + size) {}
+
+    template<typename T>
+    T get() {
+      T value;
+      memcpy(&value, take(sizeof(T)), sizeof(T));
+      return value;
+    }
+
+    std::string getString() {
+      const uint32_t length = get<uint32_t>();
+      const char* p = take(length);
+      return std::string(p, length);
+    }
+
+    /// Returns a pointer to the array inside the frame, which may be unaligned
+    template<typename T>
+    const char* getArray(uint32_t& nElements) {
+      nElements = get<uint32_t>();
+      return getValues<T>(nElements);
+    }
+
+    /// Returns a pointer to nElements values inside the frame, when the number has been read separately
+    template<typename T>
+    const char* getValues(uint32_t nElements) {
+      if(nElements > maxFrameSize / sizeof(T)) throw std::runtime_error("Malformed frame.");
+      return take(nElements * sizeof(T));
+    }
+
+    bool atEnd() const { return position == end; }
+
+   private:
+    const char* take(size_t n) {
+      if(size_t(end - position) < n) throw std::runtime_error("Malformed frame.");
+      const char* p = position;
+      position += n;
+      return p;
+    }
+
+    const char* position;
+    const char* end;
+  };
+
+  inline bool sendAll(int fd, const char* data, size_t size) {
+    while(size > 0) {
+      const ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+      if(n <= 0) return false;
+      data += n;
+      size -= n;
+    }
+    return true;
+  }
+
+  inline bool receiveAll(int fd, char* data, size_t size) {
+    while(size > 0) {
+      const ssize_t n = ::recv(fd, data, size, 0);
+      if(n <= 0) return false;
+      data += n;
+      size -= n;
+    }
+    return true;
+  }
+
+  /**
+   * @brief Receives one frame into payload, returns false if the connection is closed or broken
+   */
+  inline bool receiveFrame(int fd, std::vector<char>& payload) {
+    uint32_t length;
+    if(!receiveAll(fd, reinterpret_cast<char*>(&length), sizeof(length))) return false;
+    if(length > maxFrameSize) return false;
+    payload.resize(length);
+    return receiveAll(fd, payload.data(), length);
+  }
+
+  /**
+   * @brief Connects a blocking socket, but gives up after timeout seconds
+   *
+   * @return 0 on success, -1 on error or timeout
+   */
+  inline int connectWithTimeout(int fd, const sockaddr* socketAddress, socklen_t length, double timeout) {
+    const int flags = ::fcntl(fd, F_GETFL);
+    if((flags < 0) || (::fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0)) return -1;
+    int result = ::connect(fd, socketAddress, length);
+    if((result != 0) && (errno == EINPROGRESS)) {
+      const auto deadline = std::chrono::steady_clock::now() +
+          std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeout));
+      pollfd pfd{fd, POLLOUT, 0};
+      int ready;
+      do {
+        const auto remaining =
+            std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        ready = ::poll(&pfd, 1, std::max<int>(0, int(remaining.count())));
+      } while((ready < 0) && (errno == EINTR));
+      int error = 0;
+      socklen_t errorLength = sizeof(error);
+      result = ((ready == 1) && (::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorLength) == 0) && (error == 0)) ?
+          0 :
+          -1;
+    }
+    if(::fcntl(fd, F_SETFL, flags) != 0) return -1;
+    return result;
+  }
+
+  /**
+   * @brief Creates a socket for "tcp://host:port" or "unix:///path" and binds or connects it
+   *
+   * An empty host is the loopback interface. tcp://0.0.0.0:port listens on
+   * all interfaces, which gives every host on the network access to the
+   * devices without any authentication. A connect gives up after
+   * connectTimeout seconds.
+   *
+   * @return The socket, -1 on error with the reason in errorMessage
+   */
+  inline int openSocket(
+      const std::string& address, bool listening, std::string& errorMessage, double connectTimeout = 5) {
+    static const std::string tcpPrefix = "tcp://", unixPrefix = "unix://";
+
+    if(address.compare(0, unixPrefix.size(), unixPrefix) == 0) {
+      const std::string path = address.substr(unixPrefix.size());
+      sockaddr_un socketAddress{};
+      socketAddress.sun_family = AF_UNIX;
+      if(path.empty() || path.size() >= sizeof(socketAddress.sun_path)) {
+        errorMessage = "Invalid socket path '" + path + "'.";
+        return -1;
+      }
+      strncpy(socketAddress.sun_path, path.c_str(), sizeof(socketAddress.sun_path) - 1);
+
+      const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+      if(fd < 0) {
+        errorMessage = "Cannot create socket.";
+        return -1;
+      }
+      if(listening) ::unlink(path.c_str());
+      const sockaddr* socketAddressPointer = reinterpret_cast<const sockaddr*>(&socketAddress);
+      const int result = listening ?
+          ::bind(fd, socketAddressPointer, sizeof(socketAddress)) :
+          connectWithTimeout(fd, socketAddressPointer, sizeof(socketAddress), connectTimeout);
+      if((result != 0) || (listening && (::listen(fd, 8) != 0))) {
+        errorMessage = "Cannot " + std::string(listening ? "listen on " : "connect to ") + address + ".";
+        ::close(fd);
+        return -1;
+      }
+      return fd;
+    }
+
+    if(address.compare(0, tcpPrefix.size(), tcpPrefix) == 0) {
+      const std::string hostAndPort = address.substr(tcpPrefix.size());
+      const size_t colon = hostAndPort.rfind(':');
+      if(colon == std::string::npos) {
+        errorMessage = "Missing port in '" + address + "'.";
+        return -1;
+      }
+      const std::string host = hostAndPort.substr(0, colon), port = hostAndPort.substr(colon + 1);
+
+      addrinfo hints{};
+      hints.ai_family = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+      // Without AI_PASSIVE an empty host resolves to the loopback interface, also for listening
+      hints.ai_flags = 0;
+      addrinfo* addresses = nullptr;
+      if(::getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &addresses) != 0) {
+        errorMessage = "Cannot resolve '" + address + "'.";
+        return -1;
+      }
+
+      int fd = -1;
+      for(addrinfo* a = addresses; a && (fd < 0); a = a->ai_next) {
+        fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if(fd < 0) continue;
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if(listening) ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        const int result = listening ? ::bind(fd, a->ai_addr, a->ai_addrlen) :
+                                       connectWithTimeout(fd, a->ai_addr, a->ai_addrlen, connectTimeout);
+        if((result != 0) || (listening && (::listen(fd, 8) != 0))) {
+          ::close(fd);
+          fd = -1;
+        }
+      }
+      ::freeaddrinfo(addresses);
+      if(fd < 0) errorMessage = "Cannot " + std::string(listening ? "listen on " : "connect to ") + address + ".";
+      return fd;
+    }
+
+    errorMessage = "Invalid address '" + address + "'. Use tcp://host:port or unix:///path.";
+    return -1;
+  }
+
+} // namespace mtca4u_protocol
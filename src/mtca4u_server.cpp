@@ -0,0 +1,662 @@
+/**
+ * @file mtca4u_server.cpp
+ *
+ * @brief Server giving remote Matlab sessions access to devices over the binary protocol
+ *
+ * Usage: mtca4u_server [--dmap file] [--once] [--access user|group|all] address
+ *   address is tcp://host:port, unix:///path or shm://name. An empty host
+ *   listens on the loopback interface only. The server has no access control:
+ *   with tcp://0.0.0.0:port every host on the network can open any device
+ *   and write its registers.
+ *   With --once the server exits after the first connection is closed.
+ *   --access sets who may connect to a broker (shm://name). By default only
+ *   the user running the broker may, as permitted by the umask. group and all
+ *   open it to the group or every local user, who can then open any device
+ *   and write its registers.
+ *
+ * For sockets each connection is served by its own thread. Devices and
+ * accessors stay open until the connection is closed, so repeated requests
+ * only do the transfer. See mtca4u_protocol.h for the protocol.
+ *
+ * With shm://name the server is a broker for the Matlab sessions on the same
+ * host (see mtca4u_shm.h). A single thread serves all clients, so each device
+ * is opened only once no matter how many sessions use it, which also makes
+ * exclusive backends usable from several sessions.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <ChimeraTK/Device.h>
+#include <ChimeraTK/RegisterPath.h>
+#include <ChimeraTK/Utilities.h>
+
+#include "../include/version.h"
+#include "mtca4u_protocol.h"
+#include "mtca4u_shm.h"
+
+using namespace ChimeraTK;
+using namespace mtca4u_protocol;
+
+class Broker;
+
+// Key of a bulk segment: device, register path, offset, elements, opcode of the read
+typedef std::tuple<const Device*, std::string, uint32_t, uint32_t, uint8_t> BulkKey;
+
+/**
+ * @brief Devices and cached accessors of one connection
+ */
+class Session {
+ public:
+  /// Devices are shared through the broker if it is given
+  explicit Session(Broker* broker_ = nullptr) : broker(broker_) {}
+  ~Session();
+
+  /// Handles one request frame and returns the response frame
+  const std::vector<char>& process(const char* payload, size_t size);
+
+  /// Serves requests from a socket until the connection is closed
+  void serve(int fd);
+
+ private:
+  void handleRequest(Opcode opcode, FrameReader& request);
+  Device& getDevice(uint32_t deviceId);
+  void closeDevice(uint32_t deviceId);
+
+  template<typename T>
+  void putArray(const BulkKey& key, const T* values, size_t nElements, bool shared);
+
+  // Key: device id, register path, offset, elements
+  typedef std::tuple<uint32_t, std::string, uint32_t, uint32_t> AccessorKey;
+
+  template<typename UserType>
+  OneDRegisterAccessor<UserType>& getAccessor(std::map<AccessorKey, OneDRegisterAccessor<UserType>>& accessors,
+      const AccessorKey& key, const AccessModeFlags& flags = AccessModeFlags({}));
+
+  Broker* broker;
+  FrameWriter response;
+  std::vector<std::shared_ptr<Device>> devices; // index is the device id, NULL if closed
+  std::map<AccessorKey, OneDRegisterAccessor<double>> readAccessors;
+  std::map<AccessorKey, OneDRegisterAccessor<int32_t>> rawAccessors;
+  std::map<std::pair<uint32_t, std::string>, TwoDRegisterAccessor<double>> sequenceAccessors;
+};
+
+/**
+ * @brief Shared memory broker, owns the devices and the bulk segments of all clients
+ */
+class Broker {
+ public:
+  /// mode is the permission of the registry, 0 to respect the umask (see main)
+  Broker(const std::string& registryName_, mode_t mode_) : registryName(registryName_), mode(mode_) {}
+  ~Broker();
+
+  /// Creates the registry, returns false with the reason in errorMessage on failure
+  bool create(std::string& errorMessage);
+
+  /// Serves the clients until stopped by a signal or, with once, until the first client is gone
+  void run(bool once);
+
+  std::shared_ptr<Device> openDevice(const std::string& alias);
+
+  /// Drops a reference of a session, closes the device if no other session uses it
+  void releaseDevice(std::shared_ptr<Device>& device);
+
+  struct BulkSegment {
+    std::string name;
+    char* mapping{nullptr};
+    size_t size{0};
+    std::chrono::steady_clock::time_point timestamp;
+    bool valid{false};
+  };
+
+  /// Returns the bulk segment for key, NULL if it has never been written
+  BulkSegment* findSegment(const BulkKey& key);
+
+  /// Stores the data in the bulk segment for key and returns the segment
+  BulkSegment& storeSegment(const BulkKey& key, const void* data, size_t size);
+
+  static volatile sig_atomic_t stopRequested;
+
+ private:
+  struct Client {
+    std::unique_ptr<Session> session;
+    std::vector<char> input, output;
+    size_t outputSent{0};
+  };
+
+  bool serveClient(size_t slotIndex, Client& client);
+  void disconnectClient(size_t slotIndex);
+  void removeSegment(std::map<BulkKey, BulkSegment>::iterator it);
+
+  std::string registryName;
+  mode_t mode;
+  ShmRegistry* registry{nullptr};
+  std::map<size_t, Client> clients; // key: slot index
+  std::map<std::string, std::weak_ptr<Device>> devices; // key: alias
+  std::map<BulkKey, BulkSegment> segments;
+  size_t segmentCounter{0};
+};
+
+volatile sig_atomic_t Broker::stopRequested = 0;
+
+/********************************************************************************************************************/
+
+Session::~Session() {
+  for(uint32_t deviceId = 0; deviceId < devices.size(); ++deviceId) {
+    if(devices[deviceId]) closeDevice(deviceId);
+  }
+}
+
+void Session::serve(int fd) {
+  std::vector<char> payload;
+  while(receiveFrame(fd, payload)) {
+    const std::vector<char>& frame = process(payload.data(), payload.size());
+    if(!sendAll(fd, frame.data(), frame.size())) break;
+  }
+  ::close(fd);
+}
+
+const std::vector<char>& Session::process(const char* payload, size_t size) {
+  FrameReader request(payload, size);
+  uint32_t requestId = 0;
+  try {
+    requestId = request.get<uint32_t>();
+    const Opcode opcode = Opcode(request.get<uint8_t>());
+    response = FrameWriter();
+    response.put<uint32_t>(requestId);
+    response.put<uint8_t>(statusOk);
+    handleRequest(opcode, request);
+  }
+  catch(std::exception& e) {
+    // ChimeraTK::logic_error and runtime_error are std::exceptions as well
+    response = FrameWriter();
+    response.put<uint32_t>(requestId);
+    response.put<uint8_t>(statusError);
+    response.putString(e.what());
+  }
+  return response.getFrame();
+}
+
+Device& Session::getDevice(uint32_t deviceId) {
+  if((deviceId >= devices.size()) || !devices[deviceId]) throw std::runtime_error("Invalid device handle.");
+  return *devices[deviceId];
+}
+
+void Session::closeDevice(uint32_t deviceId) {
+  // Cached accessors must not outlive the device
+  for(auto it = readAccessors.begin(); it != readAccessors.end();)
+    it = (std::get<0>(it->first) == deviceId) ? readAccessors.erase(it) : std::next(it);
+  for(auto it = rawAccessors.begin(); it != rawAccessors.end();)
+    it = (std::get<0>(it->first) == deviceId) ? rawAccessors.erase(it) : std::next(it);
+  for(auto it = sequenceAccessors.begin(); it != sequenceAccessors.end();)
+    it = (it->first.first == deviceId) ? sequenceAccessors.erase(it) : std::next(it);
+  if(broker) {
+    broker->releaseDevice(devices[deviceId]);
+  }
+  else {
+    devices[deviceId]->close();
+    devices[deviceId].reset();
+  }
+}
+
+template<typename UserType>
+OneDRegisterAccessor<UserType>& Session::getAccessor(std::map<AccessorKey, OneDRegisterAccessor<UserType>>& accessors,
+    const AccessorKey& key, const AccessModeFlags& flags) {
+  auto it = accessors.find(key);
+  if(it == accessors.end()) {
+    Device& device = getDevice(std::get<0>(key));
+    it = accessors
+             .emplace(key,
+                 device.getOneDRegisterAccessor<UserType>(std::get<1>(key), std::get<3>(key), std::get<2>(key), flags))
+             .first;
+  }
+  return it->second;
+}
+
+/**
+ * @brief Puts an array into the response, shared reads go into the bulk segment of the broker for key
+ *
+ * Private reads are always sent inline: the segment of a key is overwritten
+ * by the next read of any session, possibly before this client has copied it.
+ */
+template<typename T>
+void Session::putArray(const BulkKey& key, const T* values, size_t nElements, bool shared) {
+  if(!broker || !shared) {
+    response.putArray(values, nElements);
+    return;
+  }
+  Broker::BulkSegment& segment = broker->storeSegment(key, values, nElements * sizeof(T));
+  response.put<uint32_t>(bulkMarker);
+  response.putString(segment.name);
+  response.put<uint32_t>(nElements);
+}
+
+void Session::handleRequest(Opcode opcode, FrameReader& request) {
+  switch(opcode) {
+    case opVersion:
+      response.putString(gVersion);
+      break;
+
+    case opOpen: {
+      const std::string alias = request.getString();
+      std::shared_ptr<Device> device;
+      if(broker) {
+        device = broker->openDevice(alias);
+      }
+      else {
+        device = std::make_shared<Device>();
+        device->open(alias);
+      }
+      devices.push_back(device);
+      response.put<uint32_t>(devices.size() - 1);
+      break;
+    }
+
+    case opClose: {
+      const uint32_t deviceId = request.get<uint32_t>();
+      getDevice(deviceId);
+      closeDevice(deviceId);
+      break;
+    }
+
+    case opRead:
+    case opReadShared: {
+      const uint32_t deviceId = request.get<uint32_t>();
+      const std::string path = request.getString();
+      const uint32_t offset = request.get<uint32_t>(), nElements = request.get<uint32_t>();
+      const bool shared = (opcode == opReadShared);
+      const double maxAge = shared ? request.get<double>() : 0.;
+      const BulkKey bulkKey(&getDevice(deviceId), path, offset, nElements, opRead);
+
+      // Another client has read the same data recently enough. Without the
+      // broker there is nobody to share with and opReadShared is a plain read.
+      Broker::BulkSegment* segment = (shared && broker) ? broker->findSegment(bulkKey) : nullptr;
+      if(segment &&
+          (std::chrono::duration<double>(std::chrono::steady_clock::now() - segment->timestamp).count() <= maxAge)) {
+        response.put<uint32_t>(bulkMarker);
+        response.putString(segment->name);
+        response.put<uint32_t>(segment->size / sizeof(double));
+        break;
+      }
+
+      auto& accessor = getAccessor(readAccessors, AccessorKey(deviceId, path, offset, nElements));
+      accessor.read();
+      putArray(bulkKey, accessor.data(), accessor.getNElements(), shared);
+      break;
+    }
+
+    case opWrite: {
+      const uint32_t deviceId = request.get<uint32_t>();
+      const std::string path = request.getString();
+      const uint32_t offset = request.get<uint32_t>();
+      uint32_t nElements;
+      const char* values = request.getArray<double>(nElements);
+      auto& accessor = getAccessor(readAccessors, AccessorKey(deviceId, path, offset, nElements));
+      memcpy(accessor.data(), values, nElements * sizeof(double));
+      accessor.write();
+      break;
+    }
+
+    case opReadRaw: {
+      const uint32_t deviceId = request.get<uint32_t>();
+      const std::string path = request.getString();
+      const uint32_t offset = request.get<uint32_t>(), nElements = request.get<uint32_t>();
+      auto& accessor = getAccessor(rawAccessors, AccessorKey(deviceId, path, offset, nElements), {AccessMode::raw});
+      accessor.read();
+      response.putArray(accessor.data(), accessor.getNElements());
+      break;
+    }
+
+    case opReadSequence: {
+      const uint32_t deviceId = request.get<uint32_t>();
+      const std::string path = request.getString();
+      auto key = std::make_pair(deviceId, path);
+      auto it = sequenceAccessors.find(key);
+      if(it == sequenceAccessors.end()) {
+        it = sequenceAccessors.emplace(key, getDevice(deviceId).getTwoDRegisterAccessor<double>(path)).first;
+      }
+      auto& accessor = it->second;
+      accessor.read();
+      const size_t nChannels = accessor.getNChannels(), nElements = accessor.getNElementsPerChannel();
+      response.put<uint32_t>(nChannels);
+      double* data = response.putArray<double>(nChannels * nElements);
+      for(size_t ic = 0; ic < nChannels; ++ic) memcpy(data + ic * nElements, accessor[ic].data(), nElements * sizeof(double));
+      break;
+    }
+
+    case opRegisterSize: {
+      const uint32_t deviceId = request.get<uint32_t>();
+      const std::string path = request.getString();
+      response.put<uint32_t>(getDevice(deviceId).getRegisterCatalogue().getRegister(path).getNumberOfElements());
+      break;
+    }
+
+    default:
+      throw std::runtime_error("Unknown opcode.");
+  }
+
+  if(!request.atEnd()) throw std::runtime_error("Malformed request.");
+}
+
+/********************************************************************************************************************/
+
+Broker::~Broker() {
+  clients.clear();
+  while(!segments.empty()) removeSegment(segments.begin());
+  if(registry) {
+    munmap(registry, sizeof(ShmRegistry));
+    shm_unlink(registryName.c_str());
+  }
+}
+
+bool Broker::create(std::string& errorMessage) {
+  // Remove the registry of a broker which did not exit cleanly, but not the one of a running broker
+  const int oldFd = shm_open(registryName.c_str(), O_RDONLY, 0);
+  if(oldFd >= 0) {
+    void* old = mmap(nullptr, sizeof(ShmRegistry), PROT_READ, MAP_SHARED, oldFd, 0);
+    ::close(oldFd);
+    const bool running = (old != MAP_FAILED) && isProcessAlive(static_cast<ShmRegistry*>(old)->brokerPid);
+    if(old != MAP_FAILED) munmap(old, sizeof(ShmRegistry));
+    if(running) {
+      errorMessage = "Another broker is already running on " + registryName + ".";
+      return false;
+    }
+    shm_unlink(registryName.c_str());
+  }
+
+  const int fd = shm_open(registryName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if((fd < 0) || (ftruncate(fd, sizeof(ShmRegistry)) != 0)) {
+    if(fd >= 0) ::close(fd);
+    errorMessage = "Cannot create the shared memory " + registryName + ".";
+    return false;
+  }
+  // Clients of other users only if explicitly requested with --access
+  if(mode != 0) fchmod(fd, mode);
+  void* mapping = mmap(nullptr, sizeof(ShmRegistry), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if(mapping == MAP_FAILED) {
+    errorMessage = "Cannot map the shared memory " + registryName + ".";
+    return false;
+  }
+
+  // The zero filled memory is a valid initial state of the atomics and rings
+  registry = static_cast<ShmRegistry*>(mapping);
+  sem_init(&registry->brokerWake, 1, 0);
+  for(auto& slot : registry->slots) sem_init(&slot.clientWake, 1, 0);
+  registry->brokerPid = getpid();
+  registry->magic = shmMagic;
+  return true;
+}
+
+std::shared_ptr<Device> Broker::openDevice(const std::string& alias) {
+  std::shared_ptr<Device> device = devices[alias].lock();
+  if(!device) {
+    device = std::make_shared<Device>();
+    device->open(alias);
+    devices[alias] = device;
+  }
+  return device;
+}
+
+void Broker::releaseDevice(std::shared_ptr<Device>& device) {
+  if(device.use_count() == 1) {
+    // The segments are keyed by the device address, which may be reused by the next device
+    for(auto it = segments.begin(); it != segments.end();) {
+      auto next = std::next(it);
+      if(std::get<0>(it->first) == device.get()) removeSegment(it);
+      it = next;
+    }
+    device->close();
+  }
+  device.reset();
+}
+
+void Broker::removeSegment(std::map<BulkKey, BulkSegment>::iterator it) {
+  if(it->second.mapping) {
+    munmap(it->second.mapping, sizeof(ShmBulkHeader) + it->second.size);
+    shm_unlink(it->second.name.c_str());
+  }
+  segments.erase(it);
+}
+
+Broker::BulkSegment* Broker::findSegment(const BulkKey& key) {
+  auto it = segments.find(key);
+  if((it == segments.end()) || !it->second.valid) return nullptr;
+  return &it->second;
+}
+
+Broker::BulkSegment& Broker::storeSegment(const BulkKey& key, const void* data, size_t size) {
+  auto it = segments.find(key);
+  // A new segment is needed if the size changed, so readers of the old one notice
+  if((it != segments.end()) && (it->second.size != size)) {
+    removeSegment(it);
+    it = segments.end();
+  }
+  if(it == segments.end()) {
+    BulkSegment segment;
+    segment.name = registryName + "_" + std::to_string(++segmentCounter);
+    segment.size = size;
+    shm_unlink(segment.name.c_str());
+    const int fd = shm_open(segment.name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if((fd < 0) || (ftruncate(fd, sizeof(ShmBulkHeader) + size) != 0)) {
+      if(fd >= 0) ::close(fd);
+      shm_unlink(segment.name.c_str());
+      throw std::runtime_error("Cannot create a shared memory segment.");
+    }
+    // Readable by the clients which may access the registry
+    if(mode != 0) fchmod(fd, mode & 0644);
+    void* mapping = mmap(nullptr, sizeof(ShmBulkHeader) + size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(mapping == MAP_FAILED) {
+      shm_unlink(segment.name.c_str());
+      throw std::runtime_error("Cannot map a shared memory segment.");
+    }
+    segment.mapping = static_cast<char*>(mapping);
+    it = segments.emplace(key, segment).first;
+  }
+
+  BulkSegment& segment = it->second;
+  ShmBulkHeader* header = reinterpret_cast<ShmBulkHeader*>(segment.mapping);
+  header->sequence.fetch_add(1, std::memory_order_acq_rel); // odd: write in progress
+  header->size = size;
+  memcpy(segment.mapping + sizeof(ShmBulkHeader), data, size);
+  header->sequence.fetch_add(1, std::memory_order_release);
+  segment.timestamp = std::chrono::steady_clock::now();
+  segment.valid = true;
+  return segment;
+}
+
+void Broker::disconnectClient(size_t slotIndex) {
+  clients.erase(slotIndex);
+  ShmSlot& slot = registry->slots[slotIndex];
+  slot.clientPid = 0;
+  slot.state = slotFree;
+}
+
+/**
+ * @brief Moves data between the rings of a client and its session, returns true if there was any progress
+ */
+bool Broker::serveClient(size_t slotIndex, Client& client) {
+  ShmSlot& slot = registry->slots[slotIndex];
+  bool progress = false;
+
+  // Receive what is there and process all complete frames
+  const size_t received = client.input.size();
+  client.input.resize(received + shmRingCapacity);
+  const size_t n = slot.requests.readSome(client.input.data() + received, shmRingCapacity);
+  client.input.resize(received + n);
+  progress |= (n > 0);
+
+  size_t position = 0;
+  while(client.input.size() - position >= sizeof(uint32_t)) {
+    uint32_t length;
+    memcpy(&length, client.input.data() + position, sizeof(length));
+    if(length > maxFrameSize) throw std::runtime_error("Malformed frame.");
+    if(client.input.size() - position - sizeof(uint32_t) < length) break;
+    const std::vector<char>& frame = client.session->process(client.input.data() + position + sizeof(uint32_t), length);
+    client.output.insert(client.output.end(), frame.begin(), frame.end());
+    position += sizeof(uint32_t) + length;
+  }
+  client.input.erase(client.input.begin(), client.input.begin() + position);
+
+  // Responses wait in output until the client has made room in the ring
+  if(client.outputSent < client.output.size()) {
+    const size_t sent =
+        slot.responses.write(client.output.data() + client.outputSent, client.output.size() - client.outputSent);
+    client.outputSent += sent;
+    progress |= (sent > 0);
+    if(client.outputSent == client.output.size()) {
+      client.output.clear();
+      client.outputSent = 0;
+    }
+  }
+
+  if(progress) sem_post(&slot.clientWake);
+  return progress;
+}
+
+void Broker::run(bool once) {
+  bool hadClient = false;
+  auto lastLivenessCheck = std::chrono::steady_clock::now();
+
+  while(!stopRequested) {
+    bool progress = false;
+    const bool checkLiveness = (std::chrono::steady_clock::now() - lastLivenessCheck > std::chrono::seconds(1));
+    if(checkLiveness) lastLivenessCheck = std::chrono::steady_clock::now();
+
+    for(size_t slotIndex = 0; slotIndex < shmSlots; ++slotIndex) {
+      ShmSlot& slot = registry->slots[slotIndex];
+      const uint32_t state = slot.state;
+
+      // Clients which crashed never set the closed state
+      if(((state == slotClaimed) || (state == slotConnected)) && checkLiveness && !isProcessAlive(slot.clientPid)) {
+        disconnectClient(slotIndex);
+        continue;
+      }
+      if(state == slotClosed) {
+        disconnectClient(slotIndex);
+        continue;
+      }
+      if(state != slotConnected) continue;
+
+      auto it = clients.find(slotIndex);
+      if(it == clients.end()) {
+        it = clients.emplace(slotIndex, Client()).first;
+        it->second.session.reset(new Session(this));
+        hadClient = true;
+      }
+      try {
+        progress |= serveClient(slotIndex, it->second);
+      }
+      catch(std::exception& e) {
+        fprintf(stderr, "Client in slot %zu disconnected: %s\n", slotIndex, e.what());
+        disconnectClient(slotIndex);
+      }
+    }
+
+    if(once && hadClient && clients.empty()) break;
+    if(!progress) waitSemaphore(&registry->brokerWake, 0.1);
+  }
+}
+
+/********************************************************************************************************************/
+
+int main(int argc, char* argv[]) {
+  std::string dmapFile, address;
+  bool once = false;
+  mode_t shmMode = 0;
+
+  for(int i = 1; i < argc; ++i) {
+    const std::string argument = argv[i];
+    if((argument == "--dmap") && (i + 1 < argc)) {
+      dmapFile = argv[++i];
+    }
+    else if(argument == "--once") {
+      once = true;
+    }
+    else if((argument == "--access") && (i + 1 < argc)) {
+      const std::string access = argv[++i];
+      if(access == "user") {
+        shmMode = 0;
+      }
+      else if(access == "group") {
+        shmMode = 0660;
+      }
+      else if(access == "all") {
+        shmMode = 0666;
+      }
+      else {
+        address.clear();
+        break;
+      }
+    }
+    else if(address.empty() && (argument[0] != '-')) {
+      address = argument;
+    }
+    else {
+      address.clear();
+      break;
+    }
+  }
+  if(address.empty()) {
+    fprintf(stderr, "Usage: %s [--dmap file] [--once] [--access user|group|all] tcp://[host]:port | unix:///path | shm://name\n",
+        argv[0]);
+    return 1;
+  }
+
+  try {
+    ChimeraTK::setDMapFilePath(dmapFile.empty() ? "./devices.dmap" : dmapFile);
+  }
+  catch(ChimeraTK::logic_error& e) {
+    // Devices can still be opened by their URI
+    if(!dmapFile.empty()) fprintf(stderr, "%s\n", e.what());
+  }
+
+  std::string errorMessage;
+
+  if(address.compare(0, shmPrefix.size(), shmPrefix) == 0) {
+    const std::string registryName = getShmRegistryName(address);
+    if(registryName.empty()) {
+      fprintf(stderr, "Invalid address '%s'.\n", address.c_str());
+      return 1;
+    }
+    // Stop cleanly, so the shared memory is removed
+    signal(SIGINT, [](int) { Broker::stopRequested = 1; });
+    signal(SIGTERM, [](int) { Broker::stopRequested = 1; });
+    Broker broker(registryName, shmMode);
+    if(!broker.create(errorMessage)) {
+      fprintf(stderr, "%s\n", errorMessage.c_str());
+      return 1;
+    }
+    broker.run(once);
+    return 0;
+  }
+
+  const int listeningSocket = openSocket(address, true, errorMessage);
+  if(listeningSocket < 0) {
+    fprintf(stderr, "%s\n", errorMessage.c_str());
+    return 1;
+  }
+
+  while(true) {
+    const int fd = ::accept(listeningSocket, nullptr, nullptr);
+    if(fd < 0) continue;
+    if(once) {
+      Session().serve(fd);
+      break;
+    }
+    std::thread([fd] { Session().serve(fd); }).detach();
+  }
+
+  ::close(listeningSocket);
+  return 0;
+}
@@ -0,0 +1,170 @@
+/**
+ * @file mtca4u_shm.h
+ *
+ * @brief Shared memory transport between the mtca4u_server broker and the mex file
+ *
+ * The broker (mtca4u_server shm://name) creates the registry /mtca4u_name
+ * with a fixed number of client slots. A client claims a free slot and then
+ * exchanges the frames of mtca4u_protocol.h through two single producer,
+ * single consumer byte rings. Each side posts the semaphore of the other side
+ * whenever it made progress, so nobody has to spin.
+ *
+ * Shared reads (opReadShared) are not copied through the rings. The broker
+ * stores their data in a shared segment per register (see ShmBulkHeader) and
+ * only sends the segment name, so the client copies the data once into the
+ * Matlab array and all clients reading the same register share the transfer.
+ * All other arrays are sent inline, as a segment may be overwritten by the
+ * next read of any session.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace mtca4u_protocol {
+
+  const std::string shmPrefix = "shm://";
+  const uint32_t shmMagic = 0x6d743473; // Changes whenever the layout changes
+  const size_t shmSlots = 16;
+  const size_t shmRingCapacity = 1 << 18; // bytes per direction and slot
+
+  enum SlotState : uint32_t { slotFree, slotClaimed, slotConnected, slotClosed };
+
+  /**
+   * @brief Byte ring with one writer and one reader process
+   *
+   * written and read count all bytes ever transferred, so the ring is empty
+   * if they are equal and full if they differ by the capacity.
+   */
+  struct ShmRing {
+    std::atomic<uint64_t> written;
+    std::atomic<uint64_t> read;
+    char data[shmRingCapacity];
+
+    void reset() {
+      written = 0;
+      read = 0;
+    }
+
+    /// Writes as many bytes as fit and returns their number
+    size_t write(const char* source, size_t size) {
+      const uint64_t w = written.load(std::memory_order_relaxed);
+      const size_t n = std::min<size_t>(size, shmRingCapacity - (w - read.load(std::memory_order_acquire)));
+      const size_t position = w % shmRingCapacity, first = std::min(n, shmRingCapacity - position);
+      memcpy(data + position, source, first);
+      memcpy(data, source + first, n - first);
+      written.store(w + n, std::memory_order_release);
+      return n;
+    }
+
+    /// Reads up to size available bytes and returns their number
+    size_t readSome(char* destination, size_t size) {
+      const uint64_t r = read.load(std::memory_order_relaxed);
+      const size_t n = std::min<size_t>(size, written.load(std::memory_order_acquire) - r);
+      const size_t position = r % shmRingCapacity, first = std::min(n, shmRingCapacity - position);
+      memcpy(destination, data + position, first);
+      memcpy(destination + first, data, n - first);
+      read.store(r + n, std::memory_order_release);
+      return n;
+    }
+  };
+
+  struct ShmSlot {
+    std::atomic<uint32_t> state;
+    std::atomic<int32_t> clientPid;
+    sem_t clientWake;
+    ShmRing requests;  // client -> broker
+    ShmRing responses; // broker -> client
+  };
+
+  struct ShmRegistry {
+    uint32_t magic;
+    std::atomic<int32_t> brokerPid;
+    sem_t brokerWake;
+    ShmSlot slots[shmSlots];
+  };
+
+  /**
+   * @brief Header of a bulk segment, followed by the data
+   *
+   * The broker makes sequence odd while it writes the data. A reader copies
+   * the data and retries if sequence was odd or changed meanwhile.
+   */
+  struct ShmBulkHeader {
+    std::atomic<uint64_t> sequence;
+    uint64_t size;
+  };
+
+  /**
+   * @brief Returns the name of the registry for "shm://name", empty if the name is invalid
+   */
+  inline std::string getShmRegistryName(const std::string& address) {
+    if(address.compare(0, shmPrefix.size(), shmPrefix) != 0) return "";
+    const std::string name = address.substr(shmPrefix.size());
+    if(name.empty() || (name.size() > 64) ||
+        (name.find_first_not_of("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-") != std::string::npos))
+      return "";
+    return "/mtca4u_" + name;
+  }
+
+  inline bool isProcessAlive(int32_t pid) {
+    return (pid > 0) && ((::kill(pid, 0) == 0) || (errno == EPERM));
+  }
+
+  /**
+   * @brief Waits for the semaphore at most timeout seconds
+   */
+  inline void waitSemaphore(sem_t* semaphore, double timeout) {
+    timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    const long nanoseconds = deadline.tv_nsec + long(timeout * 1e9);
+    deadline.tv_sec += nanoseconds / 1000000000;
+    deadline.tv_nsec = nanoseconds % 1000000000;
+    while((sem_timedwait(semaphore, &deadline) != 0) && (errno == EINTR)) {
+    }
+  }
+
+  enum BulkCopyResult { bulkCopied, bulkSizeMismatch, bulkStalled };
+
+  /**
+   * @brief Copies the data of a mapped bulk segment into destination
+   *
+   * Gives up with bulkStalled if the writer process has died in the middle of
+   * a write, or if no consistent copy succeeded within timeout seconds.
+   */
+  inline BulkCopyResult copyBulkSegment(
+      const char* segment, char* destination, size_t size, int32_t writerPid, double timeout) {
+    const ShmBulkHeader* header = reinterpret_cast<const ShmBulkHeader*>(segment);
+    const auto deadline = std::chrono::steady_clock::now() +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeout));
+    for(size_t attempt = 1;; ++attempt) {
+      const uint64_t before = header->sequence.load(std::memory_order_acquire);
+      if(before % 2 == 0) {
+        if(header->size != size) return bulkSizeMismatch;
+        memcpy(destination, segment + sizeof(ShmBulkHeader), size);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(header->sequence.load(std::memory_order_relaxed) == before) return bulkCopied;
+      }
+      // The checks are system calls, so they are not done on every retry
+      if((attempt % 1024 == 0) && (!isProcessAlive(writerPid) || (std::chrono::steady_clock::now() > deadline)))
+        return bulkStalled;
+      sched_yield();
+    }
+  }
+
+} // namespace mtca4u_protocol
@@ -1,45 +1,99 @@
-/* http://stackoverflow.com/questions/11220250/how-do-i-profile-a-mex-function-in-matlab
+
+/* Benchmark driver for the mex file.
+ *
+ * The mex file is loaded into this process and its mexFunction is called
+ * directly in a loop, so the timing does not include the Matlab interpreter.
+ * The MATLAB engine is only used to build the input arguments.
+ * See http://stackoverflow.com/questions/11220250/how-do-i-profile-a-mex-function-in-matlab
+ *
+ * Usage: mlcallmex <mex file> <scenario file> [dmap file]
+ *
+ * Scenario file format, one entry per line ('#' starts a comment):
+ *   open <variable> <device alias>
+ *     Opens the device and stores the handle in the Matlab variable.
+ *   <name> <iterations> <Matlab cell expression with the arguments of the mex function>
+ *     e.g. read_firmware 10000 {'read', dev, '', 'WORD_FIRMWARE'}
+ *
+ * For each benchmark one JSON object is printed per line on stdout with the
+ * latency statistics in microseconds, the throughput in MB/s and the number
+ * of C++ heap allocations (operator new) per call.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <new>
+#include <sstream>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
+#include <vector>
 
 #include <dlfcn.h>
-#include <errno.h>
 #include <string.h>
 
 #include "engine.h"
 
-//#include <execinfo.h>
-//#include <signal.h>
-//#include <stdlib.h>
-//#include <unistd.h>
-//#include <ucontext.h>
-
 typedef void (*mexFunction_t)(int nargout, mxArray* pargout[], int nargin, const mxArray* pargin[]);
 
+// Count the C++ heap allocations. The operators defined in the executable
+// also replace the ones used by the mex file.
+static std::atomic<size_t> allocationCount{0};
+
+void* operator new(size_t size) {
+  ++allocationCount;
+  void* p = malloc(size ? size : 1);
+  if(!p) throw std::bad_alloc();
+  return p;
+}
+void operator delete(void* p) noexcept {
+  free(p);
+}
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+/* Number of payload bytes moved by one call: the numeric outputs, or the
+ * largest numeric input for commands without output (e.g. write) */
+size_t getPayloadBytes(int nargout, mxArray* pargout[], int nargin, const mxArray* pargin[]) {
+  size_t bytes = 0;
+  for(int i = 0; i < nargout; i++) {
+    if(pargout[i] && (mxIsNumeric(pargout[i]) || mxIsLogical(pargout[i])))
+      bytes += mxGetNumberOfElements(pargout[i]) * mxGetElementSize(pargout[i]);
+  }
+  if(bytes > 0) return bytes;
+  for(int i = 1; i < nargin; i++) {
+    if(mxIsNumeric(pargin[i]))
+      bytes = std::max(bytes, mxGetNumberOfElements(pargin[i]) * mxGetElementSize(pargin[i]));
+  }
+  return bytes;
+}
+
+double getPercentile(const std::vector<double>& sorted, double percentile) {
+  size_t index = size_t(percentile / 100. * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
 int main(int argc, const char* argv[]) {
   Engine* ep;
-  char buff[1024];
-  unsigned int iteration = 1;
+
+  if(argc < 3) {
+    fprintf(stderr, "Usage: %s <mex file> <scenario file> [dmap file]\n", argv[0]);
+    return -1;
+  }
+  const char* dmapFile = (argc > 3) ? argv[3] : "dummies.dmap";
 
   /* matlab must be in the PATH! */
   if(!(ep = engOpen("matlab -nodisplay"))) {
     fprintf(stderr, "Can't start MATLAB engine\n");
     return -1;
   }
-  engOutputBuffer(ep, buff, 1023);
 
   /* load the mex file */
-  if(argc < 2) {
-    fprintf(stderr, "Error. Give full path to the MEX file as input parameter.\n");
-    return -1;
-  }
-
   void* handle = dlopen(argv[1], RTLD_NOW);
   if(!handle) {
-    fprintf(stderr, "Error loading MEX file: %s\n", strerror(errno));
+    fprintf(stderr, "Error loading MEX file: %s\n", dlerror());
     return -1;
   }
 
@@ -53,48 +107,104 @@ int main(int argc, const char* argv[]) {
     return -1;
   }
 
-  /* Get number of iteration */
-  if(argc >= 3) {
-    try {
-      iteration = std::stoul(argv[2]);
-    }
-    catch(...) {
-      // catch (const std::invalid_argument& ia) {
-      fprintf(stderr, "Exception\n");
-      return -1;
-    }
+  std::ifstream scenario(argv[2]);
+  if(!scenario) {
+    fprintf(stderr, "Cannot open scenario file %s\n", argv[2]);
+    return -1;
+  }
+
+  {
+    mxArray* pargin[2] = {mxCreateString("set_dmap"), mxCreateString(dmapFile)};
+    (*mexfunction)(0, NULL, 2, const_cast<const mxArray**>(pargin));
+    mxDestroyArray(pargin[0]);
+    mxDestroyArray(pargin[1]);
   }
 
-  /* load input data - for convenience do that using MATLAB engine */
-  /* NOTE: parameters are MEX-file specific, so one has to modify this*/
-  /* to fit particular needs */
-  engEvalString(ep, "cmd = 'read'; dev = 'SISL10'; reg = 'BOARD_WORD_FIRMWARE'");
-  mxArray* arg1 = engGetVariable(ep, "cmd");
-  mxArray* arg2 = engGetVariable(ep, "dev");
-  mxArray* arg3 = engGetVariable(ep, "reg");
-  mxArray* pargout[1] = {0};
-  const mxArray* pargin[3] = {arg1, arg2, arg3};
-
-  for(unsigned int i = 0; i < iteration; i++) {
-    if(pargout[0] != 0) {
+  std::string line;
+  unsigned int lineNumber = 0;
+  while(std::getline(scenario, line)) {
+    lineNumber++;
+    line = line.substr(0, line.find('#'));
+    std::istringstream lineStream(line);
+    std::string name;
+    if(!(lineStream >> name)) continue;
+
+    if(name == "open") {
+      std::string variable, alias;
+      if(!(lineStream >> variable >> alias)) {
+        fprintf(stderr, "Line %u: open needs a variable and a device alias\n", lineNumber);
+        return -1;
+      }
+      mxArray* pargout[1] = {NULL};
+      mxArray* pargin[2] = {mxCreateString("open"), mxCreateString(alias.c_str())};
+      (*mexfunction)(1, pargout, 2, const_cast<const mxArray**>(pargin));
+      engPutVariable(ep, variable.c_str(), pargout[0]);
+      mxDestroyArray(pargin[0]);
+      mxDestroyArray(pargin[1]);
       mxDestroyArray(pargout[0]);
-      pargout[0] = NULL;
+      continue;
     }
 
-    /* execute the mex function */
-    (*mexfunction)(1, pargout, 3, pargin);
-  }
-
-  /* execute the mex function */
-  /* (*mexfunction)(0, pargout, 0, pargin); */
+    unsigned long iterations = 0;
+    std::string expression;
+    if(!(lineStream >> iterations) || !std::getline(lineStream, expression) || iterations == 0) {
+      fprintf(stderr, "Line %u: expected <name> <iterations> <arguments>\n", lineNumber);
+      return -1;
+    }
 
-  /* print the results using MATLAB engine */
-  engPutVariable(ep, "result", pargout[0]);
-  engEvalString(ep, "result");
-  printf("%s\n", buff);
+    /* load input data - for convenience do that using MATLAB engine */
+    engEvalString(ep, ("benchmark_args = " + expression + ";").c_str());
+    mxArray* args = engGetVariable(ep, "benchmark_args");
+    if(!args || !mxIsCell(args) || mxGetNumberOfElements(args) == 0) {
+      fprintf(stderr, "Line %u: the arguments must be a non-empty cell array\n", lineNumber);
+      return -1;
+    }
+    const int nargin = mxGetNumberOfElements(args);
+    std::vector<const mxArray*> pargin(nargin);
+    for(int i = 0; i < nargin; i++) pargin[i] = mxGetCell(args, i);
+
+    const int nargout = 1;
+    mxArray* pargout[nargout] = {NULL};
+    std::vector<double> latencies(iterations);
+    size_t bytes = 0;
+    size_t allocations = 0;
+
+    // One call to warm up caches and lazily created accessors
+    (*mexfunction)(nargout, pargout, nargin, pargin.data());
+
+    for(unsigned long i = 0; i < iterations; i++) {
+      if(pargout[0] != NULL) {
+        mxDestroyArray(pargout[0]);
+        pargout[0] = NULL;
+      }
+
+      const size_t allocationsBefore = allocationCount;
+      auto start = std::chrono::steady_clock::now();
+      /* execute the mex function */
+      (*mexfunction)(nargout, pargout, nargin, pargin.data());
+      auto stop = std::chrono::steady_clock::now();
+      allocations += allocationCount - allocationsBefore;
+
+      latencies[i] = std::chrono::duration<double, std::micro>(stop - start).count();
+      bytes += getPayloadBytes(nargout, pargout, nargin, pargin.data());
+    }
+    if(pargout[0] != NULL) mxDestroyArray(pargout[0]);
+    mxDestroyArray(args);
+
+    double total = 0;
+    for(double latency : latencies) total += latency;
+    std::sort(latencies.begin(), latencies.end());
+
+    printf("{\"name\": \"%s\", \"iterations\": %lu, \"mean_us\": %.3f, \"min_us\": %.3f, \"p50_us\": %.3f, "
+           "\"p90_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f, \"bytes_per_call\": %.1f, \"mb_per_s\": %.3f, "
+           "\"allocations_per_call\": %.2f}\n",
+        name.c_str(), iterations, total / iterations, latencies.front(), getPercentile(latencies, 50),
+        getPercentile(latencies, 90), getPercentile(latencies, 99), latencies.back(), double(bytes) / iterations,
+        total > 0 ? bytes / total : 0., double(allocations) / iterations);
+    fflush(stdout);
+  }
 
   /* cleanup */
-  mxDestroyArray(pargout[0]);
   engEvalString(ep, "clear all;");
   dlclose(handle);
   engClose(ep);
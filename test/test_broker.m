@@ -0,0 +1,64 @@
+%%
+% Several sessions sharing the devices through the mtca4u_server broker. The
+% broker exits after the last client has disconnected.
+address = 'shm://mtca4u_test_broker';
+system(['../mtca4u_server --once --dmap dummies.dmap ', address, ' &']);
+
+% Wait for the broker to create the shared memory
+for i = 1:50
+  try
+    m1 = mtca4u_remote('DUMMY1', address);
+    break;
+  catch
+    pause(0.1);
+  end
+end
+assert(exist('m1', 'var') == 1, 'Cannot connect to the broker');
+m2 = mtca4u_remote('DUMMY1', address);
+
+%% Both clients use the same device
+
+m1.write('', 'WORD_USER', 3.5);
+assert(m2.read('', 'WORD_USER') == 3.5, 'Clients of the broker must share the device');
+assert(m2.read_raw('', 'WORD_USER') == 28, 'Wrong raw value returned.');
+
+%% Shared reads go through a bulk segment
+
+m1.write('', 'WORD_ADC_ENA', 1); % Fill AREA_DMAABLE with n^2
+ref = (0:1:24).^2;
+readback1 = m1.read_shared('', 'AREA_DMAABLE', 10);
+readback2 = m2.read_shared('', 'AREA_DMAABLE', 10, 0, 25);
+assert(isequal(readback1(1:25), ref), 'Wrong array read back');
+assert(isequal(readback2, ref), 'Wrong array read back');
+readback = m2.read_shared('', 'AREA_DMAABLE', 10);
+assert(isequal(readback, readback1), 'Shared read must return the data of the other client');
+
+%% A large batch wraps the rings many times
+
+requests = repmat({{'read', '', 'AREA_DMAABLE'}}, 1, 2000);
+results = m1.pipeline(requests);
+assert(numel(results) == 2000 && isequal(results{end}(1:25), ref), 'Wrong result of a large batch');
+
+%% Large private reads are not overwritten by later reads
+
+l1 = mtca4u_remote('(dummy?map=large.map)', address);
+l2 = mtca4u_remote('(dummy?map=large.map)', address);
+up = 1:16384;
+down = 16384:-1:1;
+l1.write('', 'AREA_LARGE', up);
+results = l1.pipeline({{'read', '', 'AREA_LARGE'}, {'write', '', 'AREA_LARGE', down}, {'read', '', 'AREA_LARGE'}});
+assert(isequal(results{1}, up) && isequal(results{3}, down), 'Reads of a batch must not share their data');
+% A read of another session in between must not change the data of this one
+l1.write('', 'AREA_LARGE', up);
+results = l1.pipeline({{'read', '', 'AREA_LARGE'}});
+l2.write('', 'AREA_LARGE', down);
+assert(isequal(l2.read('', 'AREA_LARGE'), down), 'Wrong array read back');
+assert(isequal(results{1}, up), 'Read overwritten by another session');
+assert(isequal(l1.read_shared('', 'AREA_LARGE', 10), down), 'Wrong array of a large shared read');
+clear l1 l2 up down
+
+check_error(@()m2.read('', 'NO_SUCH_REGISTER'), 'Unknown register excepted');
+check_error(@()mtca4u_mex('remote_connect', 'shm://no_such_broker'), 'Missing broker excepted');
+check_error(@()mtca4u_mex('remote_connect', 'shm://in/valid'), 'Invalid name excepted');
+
+clear m1 m2 readback readback1 readback2 results requests ref
@@ -0,0 +1,40 @@
+%%
+%
+mtca4u_mex('set_dmap','dummies.dmap');
+
+%% Handles of the same alias share the device
+
+h1 = mtca4u_mex('open', 'DUMMY1');
+h2 = mtca4u_mex('open', 'DUMMY1');
+assert(h1 ~= h2, 'Handles must be unique');
+mtca4u_mex('write', h1, '', 'WORD_USER', 3);
+assert(mtca4u_mex('read', h2, '', 'WORD_USER') == 3, 'Handles of the same alias must share the device');
+mtca4u_mex('close', h1);
+assert(mtca4u_mex('read', h2, '', 'WORD_USER') == 3, 'Device closed while still in use by another handle');
+
+%% Closed handles are detected and their slots are reused
+
+check_error(@()mtca4u_mex('read', h1, '', 'WORD_USER'), 'Closed handle excepted');
+mtca4u_mex('close', h1);
+h3 = mtca4u_mex('open', 'DUMMY2');
+assert(h3 ~= h1, 'Stale handle must not become valid again');
+check_error(@()mtca4u_mex('read', h1, '', 'WORD_USER'), 'Stale handle excepted');
+mtca4u_mex('close', h2);
+mtca4u_mex('close', h3);
+check_error(@()mtca4u_mex('close', 1e9), 'Invalid handle excepted');
+check_error(@()mtca4u_mex('open', 'NO_SUCH_DEVICE'), 'Unknown device excepted');
+clear h1 h2 h3
+
+%% Register handle slots are reused with a new handle
+
+h1 = mtca4u_mex('open', 'DUMMY1');
+r1 = mtca4u_mex('resolve', h1, '', 'WORD_COMPILATION');
+mtca4u_mex('close', h1);
+check_error(@()mtca4u_mex('read_h', r1), 'Released register handle excepted');
+h1 = mtca4u_mex('open', 'DUMMY1');
+r2 = mtca4u_mex('resolve', h1, '', 'WORD_COMPILATION');
+assert(r1 ~= r2, 'Register handles must not repeat');
+assert(mtca4u_mex('read_h', r2) == 9, 'Wrong value read through the reused slot');
+check_error(@()mtca4u_mex('read_h', r1), 'Stale register handle excepted');
+mtca4u_mex('close', h1);
+clear h1 r1 r2
@@ -14,3 +14,23 @@ check_error(@()mtca4u_mex('nop'), 'Illegal command excepted');
 
 mtca4u_mex('version')
 
+%% Check the numeric opcodes
+%
+op = mtca4u_mex('opcode', 'version');
+assert(isa(op, 'uint32'), 'Opcode has wrong class');
+assert(strcmp(mtca4u_mex(op), mtca4u_mex('version')), 'Opcode dispatched to wrong command');
+assert(strcmp(mtca4u_mex('VERSION'), mtca4u_mex('version')), 'Command names must be case insensitive');
+check_error(@()mtca4u_mex(uint32(100000)), 'Illegal opcode excepted');
+check_error(@()mtca4u_mex('opcode', 'foo'), 'Illegal command excepted');
+clear op
+
+
+%% Check the fixed point conversions
+%
+assert(isequal(mtca4u_mex('cd2ui', [-1 1.5 1000], 8, 1), [254 3 127]), 'Wrong cd2ui conversion');
+assert(isequal(mtca4u_mex('cui2d', [254 3 127 -5], 8, 1), [-1 1.5 63.5 0]), 'Wrong cui2d conversion');
+assert(isequal(mtca4u_mex('cd2si', [-1 1.5; 1000 -1000], 8, 1), [-2 3; 127 -128]), 'Wrong cd2si conversion');
+assert(isequal(mtca4u_mex('csi2d', int16([-2 3 200]), 8, 1), [-1 1.5 63.5]), 'Wrong csi2d conversion');
+check_error(@()mtca4u_mex('cd2ui', 1, 0, 0), 'Illegal number of bits excepted');
+check_error(@()mtca4u_mex('cd2ui', 1, 8.5, 0), 'Fractional number of bits excepted');
+check_error(@()mtca4u_mex('cd2si', 1, 8, 0.5), 'Fractional number of fractional bits excepted');
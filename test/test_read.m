@@ -71,3 +71,282 @@ readback = m.read_raw('', 'AREA_DMAABLE', offset, elements);
 assert(numel(readback) == elements, 'Wrong number of elements read back');
 assert(isequal(readback, ref(offset+1:offset+elements)), 'Wrong array read back');
 clear readback offset
+
+%% Check reading through register handles
+
+h = m.resolve('', 'WORD_COMPILATION');
+assert(m.read_h(h) == 9, 'Wrong compilation returned through handle.');
+assert(m.resolve('', 'WORD_COMPILATION') == h, 'Register handle not reused.');
+h_raw = m.resolve('', 'AREA_DMAABLE', 4, 10, 'raw');
+readback = m.read_h(h_raw);
+assert(isa(readback, 'int32'), 'Wrong class read back through raw handle');
+assert(isequal(double(readback), m.read_raw('', 'AREA_DMAABLE', 4, 10)), 'Wrong array read back through handle');
+check_error(@()m.read_h(-1), 'Illegal handle excepted');
+check_error(@()m.resolve('', 'WORD_COMPILATION', 0, 0, 'foo'), 'Illegal type excepted');
+clear h h_raw readback
+
+%% Check reading several registers at once
+
+data = m.read_many({{'', 'WORD_FIRMWARE'}, {'', 'WORD_COMPILATION'}, {'', 'AREA_DMAABLE', 4, 10}});
+assert(iscell(data) && numel(data) == 3, 'Wrong number of registers read back');
+assert(data{1} == 0, 'Wrong firmware id returned.');
+assert(data{2} == 9, 'Wrong compilation returned.');
+assert(isequal(data{3}, m.read('', 'AREA_DMAABLE', 4, 10)), 'Wrong array read back');
+check_error(@()m.read_many({'', 'WORD_FIRMWARE'}), 'Illegal spec excepted');
+check_error(@()m.read_many({{'', 'WORD_FIRMWARE', -1}}), 'Illegal offset excepted');
+clear data
+
+%% Check the triggered capture
+
+[data, latency, polls] = m.capture('', 'WORD_COMPILATION', 'equal', 9, {{'', 'WORD_FIRMWARE'}, {'', 'AREA_DMAABLE', 4, 10}});
+assert(iscell(data) && numel(data) == 2, 'Wrong number of registers captured');
+assert(data{1} == 0, 'Wrong firmware id captured.');
+assert(isequal(data{2}, m.read('', 'AREA_DMAABLE', 4, 10)), 'Wrong array captured');
+assert(polls == 1 && latency >= 0, 'Trigger condition must be met on the first poll');
+[~, ~, polls] = m.capture('', 'WORD_COMPILATION', 'bitmask', 8, {{'', 'WORD_FIRMWARE'}});
+assert(polls == 1, 'Bitmask condition must be met on the first poll');
+[~, ~, polls] = m.capture('', 'WORD_COMPILATION', 'threshold', 9, {{'', 'WORD_FIRMWARE'}});
+assert(polls == 1, 'Threshold condition must be met on the first poll');
+check_error(@()m.capture('', 'WORD_COMPILATION', 'changed', [], {{'', 'WORD_FIRMWARE'}}, 0.01, 10, 0.001), 'Timeout excepted');
+check_error(@()m.capture('', 'WORD_COMPILATION', 'equal', 1, {{'', 'WORD_FIRMWARE'}}, 0.01), 'Timeout excepted');
+check_error(@()m.capture('', 'WORD_COMPILATION', 'foo', 1, {{'', 'WORD_FIRMWARE'}}), 'Illegal condition excepted');
+check_error(@()m.capture('', 'WORD_COMPILATION', 'bitmask', -1, {{'', 'WORD_FIRMWARE'}}), 'Illegal bitmask excepted');
+check_error(@()m.capture('', 'WORD_COMPILATION', 'bitmask', 2^64, {{'', 'WORD_FIRMWARE'}}), 'Illegal bitmask excepted');
+% A negative trigger value is taken as two's complement
+m.write('', 'WORD_USER', -1);
+[~, ~, polls] = m.capture('', 'WORD_USER', 'bitmask', 8, {{'', 'WORD_FIRMWARE'}});
+assert(polls == 1, 'Bitmask condition must be met by a negative trigger value');
+m.write('', 'WORD_USER', 10.25);
+clear data latency polls
+
+%% Check reading the same register from several devices
+
+m2 = mtca4u('DUMMY1');
+data = mtca4u.read_multi_device([m, m2], '', 'AREA_DMAABLE', 4, 10);
+assert(isequal(size(data), [10, 2]), 'Wrong size of the multi device read');
+assert(isequal(data(:, 1)', m.read('', 'AREA_DMAABLE', 4, 10)) && isequal(data(:, 1), data(:, 2)), 'Wrong multi device data');
+h = mtca4u_mex('open', 'DUMMY1');
+assert(isequal(mtca4u_mex('read_multi_device', [h, h, h], '', 'WORD_COMPILATION'), [9, 9, 9]), 'Wrong values read from the handles');
+mtca4u_mex('close', h);
+check_error(@()mtca4u_mex('read_multi_device', [h, h], '', 'WORD_COMPILATION'), 'Closed handle excepted');
+check_error(@()mtca4u_mex('read_multi_device', [], '', 'WORD_COMPILATION'), 'Missing handles excepted');
+check_error(@()mtca4u.read_multi_device([m, m2], '', 'CLK_DUMMY'), 'Illegal register excepted');
+clear data h m2
+
+%% Check the asynchronous reads
+
+t1 = m.read_async('read', '', 'AREA_DMAABLE', 4, 10);
+t2 = m.read_async('read_raw', '', 'WORD_COMPILATION');
+s = mtca4u('DUMMY2');
+t3 = s.read_async('read_seq', 'TEST', 'INT');
+assert(isequal(m.read_fetch(t1), m.read('', 'AREA_DMAABLE', 4, 10)), 'Wrong data of the asynchronous read');
+while ~m.read_ready(t2)
+  pause(0.001);
+end
+data = m.read_fetch(t2);
+assert(isa(data, 'int32') && data == 9, 'Wrong data of the asynchronous raw read');
+assert(isequal(s.read_fetch(t3), s.read_seq('TEST', 'INT')), 'Wrong data of the asynchronous sequence read');
+check_error(@()m.read_fetch(t1), 'Fetched ticket excepted');
+
+% Other commands on the device while tickets are pending
+expected = m.read('', 'AREA_DMAABLE');
+tickets = arrayfun(@(i)m.read_async('read', '', 'AREA_DMAABLE'), 1:16);
+for i = 1:16
+  assert(isequal(m.read('', 'AREA_DMAABLE'), expected), 'Wrong data while a ticket is pending');
+  m.write('', 'WORD_USER', i);
+end
+for i = 1:16
+  assert(isequal(m.read_fetch(tickets(i)), expected), 'Wrong data of a pending ticket');
+end
+assert(m.read('', 'WORD_USER') == 16, 'Write lost while tickets were pending');
+m.write('', 'WORD_USER', 10.25); % The fixed point checks below rely on it
+clear expected tickets
+check_error(@()m.read_ready(-1), 'Invalid ticket excepted');
+check_error(@()m.read_async('write', '', 'WORD_USER'), 'Illegal command excepted');
+check_error(@()m.read_async('read', '', 'CLK_DUMMY'), 'Illegal register excepted');
+clear data s t1 t2 t3
+
+%% Check the reductions in the read path
+
+area = m.read('', 'AREA_DMAABLE', 0, 20);
+assert(isequal(m.read('', 'AREA_DMAABLE', 0, 20, {'decimate', 3}), area(1:3:end)), 'Wrong decimation');
+assert(isa(m.read('', 'AREA_DMAABLE', 0, 20, 'int32', {'decimate', 3}), 'int32'), 'Decimation must keep the output class');
+assert(max(abs(m.read('', 'AREA_DMAABLE', 0, 20, {'mean', 5}) - mean(reshape(area, 5, 4)))) < 1e-9, 'Wrong block mean');
+assert(max(abs(m.read('', 'AREA_DMAABLE', 0, 20, {'rms', 20}) - sqrt(mean(area.^2)))) < 1e-9, 'Wrong rms');
+assert(isequal(m.read('', 'AREA_DMAABLE', 0, 20, {'minmax', 2}), [min(area(1:10)), min(area(11:20)); max(area(1:10)), max(area(11:20))]), 'Wrong min/max envelope');
+edges = [min(area), mean(area), max(area)];
+counts = m.read('', 'AREA_DMAABLE', 0, 20, {'histogram', edges});
+assert(sum(counts) == 20 && counts(1) == sum(area < edges(2)), 'Wrong histogram');
+raw = m.read_raw('', 'AREA_DMAABLE', 0, 20);
+assert(isequal(m.read_raw('', 'AREA_DMAABLE', 0, 20, {'decimate', 4}), raw(1:4:end)), 'Wrong raw decimation');
+s = mtca4u('DUMMY2');
+sequences = s.read_seq('TEST', 'INT');
+assert(isequal(s.read_seq('TEST', 'INT', 1:size(sequences, 2), 0, size(sequences, 1), {'minmax', 1}), cat(3, min(sequences), max(sequences))), 'Wrong sequence envelope');
+check_error(@()m.read('', 'AREA_DMAABLE', 0, 20, {'median', 2}), 'Illegal reduction excepted');
+check_error(@()m.read('', 'AREA_DMAABLE', 0, 20, {'mean', 0}), 'Illegal block size excepted');
+check_error(@()m.read('', 'AREA_DMAABLE', 0, 20, {'histogram', [2, 1]}), 'Illegal edges excepted');
+clear area counts edges raw s sequences
+
+%% Check reading into other classes than double
+
+readback = m.read('', 'AREA_DMAABLE', 0, 10, 'int16');
+assert(isa(readback, 'int16'), 'Wrong class read back');
+assert(isequal(readback, int16(m.read('', 'AREA_DMAABLE', 0, 10))), 'Wrong array read back');
+readback = m.read('', 'WORD_COMPILATION', 'single');
+assert(isa(readback, 'single') && readback == 9, 'Wrong compilation returned.');
+readback = m.read('', 'WORD_COMPILATION', 'native');
+assert(isa(readback, 'uint32') && readback == 9, 'A 32 bit unsigned register must be read as uint32');
+readback = m.read('', 'WORD_USER', 'native');
+assert(isa(readback, 'double'), 'A fixed point register with fractional bits must be read as double');
+check_error(@()m.read('', 'WORD_COMPILATION', 'foo'), 'Illegal class excepted');
+clear readback
+
+%% Check chunked reading of large registers
+
+m.write('', 'WORD_ADC_ENA', 1);
+reference = m.read('', 'AREA_DMAABLE');
+reference_raw = m.read_raw('', 'AREA_DMAABLE', 3);
+mtca4u_mex('set_chunk_size', 100);
+assert(mtca4u_mex('get_chunk_size') == 100, 'Wrong chunk size returned');
+assert(isequal(m.read('', 'AREA_DMAABLE'), reference), 'Wrong array read back in chunks');
+assert(isequal(m.read_raw('', 'AREA_DMAABLE', 3), reference_raw), 'Wrong raw array read back in chunks');
+assert(isequal(m.read('', 'AREA_DMAABLE', 10, 250), reference(11:260)), 'Wrong array read back in chunks');
+mtca4u.stats_reset();
+assert(isequal(m.read('', 'AREA_DMAABLE', 10, 250), reference(11:260)), 'Wrong array read back through cached chunks');
+s = mtca4u.stats();
+c = s.commands(strcmp({s.commands.name}, 'read'));
+assert(c.setup.count == 0 && c.transfer.count == 1, 'Chunk accessors not reused');
+mtca4u.stats_reset();
+clear s c
+mtca4u_mex('set_chunk_size', 0);
+check_error(@()mtca4u_mex('set_chunk_size', -1), 'Illegal chunk size excepted');
+clear reference reference_raw
+
+%% Check waiting for pushed updates
+
+check_error(@()m.read_wait('', 'WORD_COMPILATION', 1, 'foo'), 'Illegal mode excepted');
+check_error(@()m.read_wait('', 'WORD_COMPILATION', -1), 'Negative timeout excepted');
+check_error(@()m.read_wait('', 'WORD_COMPILATION', Inf), 'Infinite timeout excepted');
+check_error(@()m.read_wait('', 'WORD_COMPILATION', 0.01), 'Register without wait_for_new_data excepted');
+check_error(@()m.read_wait('', 'WORD_COMPILATION', 0, 'nonblocking'), 'Register without wait_for_new_data excepted');
+
+%% Check the continuous acquisition
+
+h = m.acq_start('', 'WORD_COMPILATION', 0.01, 1000);
+pause(0.2);
+[data, timestamps, overruns] = m.acq_fetch(h);
+assert(size(data, 2) > 0 && all(data == 9), 'Wrong data acquired');
+assert(numel(timestamps) == size(data, 2) && all(diff(timestamps) > 0), 'Wrong timestamps acquired');
+assert(overruns == 0, 'Unexpected overruns');
+m.acq_stop(h);
+check_error(@()m.acq_fetch(h), 'Stopped acquisition excepted');
+clear h data timestamps overruns
+
+%% Check recording to a file
+
+file = [tempname, '.rec'];
+h = m.record_start({{'', 'WORD_COMPILATION'}, {'', 'AREA_DMAABLE', 0, 10}}, file, 0.01, 'int32');
+pause(0.2);
+nBlocks = m.record_stop(h);
+rec = mtca4u.record_open(file);
+assert(rec.nBlocks == nBlocks && nBlocks > 0, 'Wrong number of blocks recorded');
+assert(strcmp(rec.registers(2).class, 'int32') && rec.registers(2).nElementsPerChannel == 10, 'Wrong register info');
+rec = mtca4u.record_open(file, 1, 2);
+assert(isequal(size(rec.data{2}), [10 1 2]) && isa(rec.data{2}, 'int32'), 'Wrong data size read back');
+assert(all(rec.data{1} == 9), 'Wrong data recorded');
+assert(numel(rec.timestamps) == 2, 'Wrong number of timestamps read back');
+check_error(@()mtca4u.record_open(file, nBlocks + 1), 'Illegal offset excepted');
+% Corrupt the number of registers in the file header
+fid = fopen(file, 'r+');
+fseek(fid, 12, 'bof');
+fwrite(fid, intmax('uint32'), 'uint32');
+fclose(fid);
+check_error(@()mtca4u.record_open(file), 'Invalid number of registers excepted');
+delete(file);
+clear fid file h nBlocks rec
+
+%% Check the performance counters
+
+mtca4u.stats_reset();
+for i = 1:3
+  m.read('', 'WORD_FIRMWARE');
+end
+s = mtca4u.stats();
+c = s.commands(strcmp({s.commands.name}, 'read'));
+assert(numel(c) == 1 && c.calls == 3, 'Wrong number of calls counted');
+assert(c.transfer.count == 3 && c.total.min <= c.total.max && sum(c.total.histogram) == 3, 'Wrong latencies counted');
+t = s.transfers(strcmp({s.transfers.register}, '/WORD_FIRMWARE'));
+assert(numel(t) == 1 && t.transfers == 3 && t.bytes == 3 * 8, 'Wrong bytes counted');
+assert(numel(s.histogram_edges) == numel(c.total.histogram), 'Wrong histogram edges');
+mtca4u.stats_reset();
+assert(isempty(mtca4u.stats().commands), 'Counters not reset');
+clear i s c t
+
+%% Check the call trace
+
+file = [tempname, '.json'];
+mtca4u.trace_start(100);
+for i = 1:3
+  m.read('', 'WORD_FIRMWARE');
+end
+mtca4u.trace_stop();
+m.read('', 'WORD_FIRMWARE');
+n = mtca4u.trace_dump(file);
+trace = jsondecode(fileread(file));
+events = trace.traceEvents;
+if ~iscell(events)
+  events = num2cell(events);
+end
+calls = events(cellfun(@(e) strcmp(e.cat, 'command') && strcmp(e.name, 'read'), events));
+assert(numel(events) == n && numel(calls) == 3, 'Wrong number of traced calls');
+assert(calls{1}.args.bytes == 8 && calls{1}.dur >= 0, 'Wrong call traced');
+assert(any(cellfun(@(e) strcmp(e.cat, 'transfer') && strcmp(e.name, '/WORD_FIRMWARE'), events)), 'Transfer not traced');
+assert(any(cellfun(@(e) strcmp(e.cat, 'phase') && strcmp(e.name, 'transfer'), events)), 'Phase not traced');
+mtca4u.trace_start(8);
+for i = 1:3
+  m.read('', 'WORD_FIRMWARE');
+end
+mtca4u.trace_stop();
+assert(mtca4u.trace_dump(file) == 8, 'Ring buffer not limited to its capacity');
+delete(file);
+check_error(@()mtca4u.trace_start(0), 'Illegal capacity excepted');
+check_error(@()mtca4u.trace_dump('/no/such/dir/trace.json'), 'Illegal file excepted');
+clear calls events file i n trace
+
+%% Check the device probing of info
+
+info = mtca4u_mex('info', 5);
+assert(numel(info) == 2 && strcmp(info(1).name, 'DUMMY1') && strcmp(info(2).name, 'DUMMY2'), 'Wrong devices probed');
+assert(isequal(mtca4u_mex('info'), info), 'Cached device info differs');
+assert(strcmp(mtca4u_mex('get_dmap'), 'dummies.dmap'), 'info changed the dmap file');
+check_error(@()mtca4u_mex('info', -1), 'Illegal timeout excepted');
+clear info
+
+%% Check the register search
+
+names = m.find_registers('AREA_DMAABLE*');
+assert(numel(names) == 3 && all(strncmp(names, '/AREA_DMAABLE', 13)), 'Wrong registers found by glob');
+assert(isequal(m.find_registers('/WORD_FIRMWARE'), {'/WORD_FIRMWARE'}), 'Wrong register found by name');
+assert(isempty(m.find_registers('NO_SUCH_REGISTER')), 'Unexpected register found');
+assert(isequal(sort(m.find_registers('^AREA_DMAABLE_FIXEDPOINT1[06]_', 'regex')), ...
+  {'/AREA_DMAABLE_FIXEDPOINT10_1'; '/AREA_DMAABLE_FIXEDPOINT16_3'}), 'Wrong registers found by regex');
+check_error(@()m.find_registers('*', 'foo'), 'Illegal mode excepted');
+clear names
+
+%% Check the columnar device info
+
+info = m.device_info();
+columns = m.device_info('columns');
+assert(isequal(columns.name, {info.name}') && isequal(columns.nElementsPerChannel, [info.nElementsPerChannel]'), ...
+  'Columnar device info differs');
+assert(islogical(columns.isSigned) && numel(columns.isSigned) == numel(info), 'Wrong flag column');
+check_error(@()m.device_info('rows'), 'Illegal format excepted');
+clear info columns
+
+%% Check the fixed point conversion of raw reads
+
+assert(m.read_raw('', 'WORD_USER', 0, 1, true, 12, 3) == m.read('', 'WORD_USER'), 'Wrong fixed point conversion');
+assert(isa(m.read_raw('', 'WORD_USER', 0, 1, true, 12, 3, 'single'), 'single'), 'Wrong class of fixed point read');
+assert(m.read_raw('', 'WORD_USER', 0, 1, false, 4, 1) == 1, 'Wrong unsigned fixed point conversion');
+check_error(@()m.read_raw('', 'WORD_USER', 0, 1, true, 33, 3), 'Illegal number of bits excepted');
+check_error(@()m.read_raw('', 'WORD_USER', 0, 1, 'single'), 'Class without fixed point format excepted');
@@ -0,0 +1,78 @@
+%%
+% Access through mtca4u_server with the binary protocol. The server exits
+% after the connection is closed.
+address = 'unix:///tmp/mtca4u_test_server.sock';
+system(['../mtca4u_server --once --dmap dummies.dmap ', address, ' &']);
+
+% Wait for the server to listen
+for i = 1:50
+  try
+    m = mtca4u_remote('DUMMY1', address);
+    break;
+  catch
+    pause(0.1);
+  end
+end
+assert(exist('m', 'var') == 1, 'Cannot connect to the server');
+
+%% Single requests
+
+assert(m.read('', 'WORD_COMPILATION') == 9, 'Wrong compilation returned.');
+m.write('', 'WORD_USER', 10.25);
+assert(m.read('', 'WORD_USER') == 10.25, 'Wrong word user value returned.');
+assert(m.get_register_size('', 'AREA_DMAABLE') == 1024, 'Wrong register size returned.');
+assert(strcmp(m.version(), mtca4u_mex('version')), 'Wrong server version returned.');
+
+check_error(@()m.read('', 'NO_SUCH_REGISTER'), 'Unknown register excepted');
+check_error(@()m.read('', 'WORD_CLK_DUMMY', 500), 'Illegal parameter excepted');
+% The connection is still usable after an error
+assert(m.read('', 'WORD_COMPILATION') == 9, 'Connection broken by an error.');
+
+%% Pipelined requests
+
+m.write('', 'WORD_ADC_ENA', 1); % Fill AREA_DMAABLE with n^2
+ref = (0:1:24).^2;
+results = m.pipeline({{'write', '', 'WORD_CLK_MUX', [1 2 3 4]}, {'read', '', 'WORD_CLK_MUX'}, ...
+  {'read', '', 'AREA_DMAABLE', 5, 20}, {'read_raw', '', 'WORD_USER'}, {'register_size', '', 'WORD_CLK_MUX'}});
+assert(isempty(results{1}), 'Write must not return a value');
+assert(isequal(results{2}, [1 2 3 4]), 'Wrong array read back');
+assert(isequal(results{3}, ref(6:25)), 'Wrong array read back');
+assert(results{4} == 82 && isa(results{4}, 'int32'), 'Wrong raw value read back');
+assert(results{5} == 4, 'Wrong register size returned');
+
+% A large batch exceeds the socket buffers in both directions
+requests = repmat({{'read', '', 'AREA_DMAABLE'}}, 1, 2000);
+results = m.pipeline(requests);
+assert(numel(results) == 2000 && isequal(results{end}(1:25), ref), 'Wrong result of a large batch');
+
+check_error(@()m.pipeline({{'read', '', 'WORD_COMPILATION'}, {'read', '', 'NO_SUCH_REGISTER'}}), 'Failed request excepted');
+check_error(@()m.pipeline({{'no_such_command'}}), 'Unknown command excepted');
+
+%% Invalid connections
+
+check_error(@()mtca4u_mex('remote_request', m.connection, {{'open', 'NO_SUCH_DEVICE'}}), 'Unknown device excepted');
+check_error(@()mtca4u_mex('remote_connect', 'udp://localhost:1'), 'Invalid address excepted');
+check_error(@()mtca4u_mex('remote_request', 1e9, {{'version'}}), 'Closed connection excepted');
+check_error(@()mtca4u_mex('remote_connect', address, -1), 'Invalid timeout excepted');
+
+% A stalled server fails the request after the timeout and drops the connection
+stalled = 'unix:///tmp/mtca4u_test_stalled.sock';
+system(['../mtca4u_server --once --dmap dummies.dmap ', stalled, ' &']);
+for i = 1:50
+  try
+    h = mtca4u_mex('remote_connect', stalled, 0.5);
+    break;
+  catch
+    pause(0.1);
+  end
+end
+assert(exist('h', 'var') == 1, 'Cannot connect to the server');
+system('pkill -STOP -f mtca4u_test_stalled');
+tic;
+check_error(@()mtca4u_mex('remote_request', h, {{'version'}}), 'Timeout excepted');
+assert(toc < 5, 'Timeout not applied');
+check_error(@()mtca4u_mex('remote_request', h, {{'version'}}), 'Dropped connection excepted');
+system('pkill -CONT -f mtca4u_test_stalled');
+clear h stalled
+
+clear m results requests ref
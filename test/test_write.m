@@ -115,6 +115,18 @@ register_size = m.get_register_size('','AREA_DMAABLE');
 assert(numel(readback) == register_size, 'Wrong number of elements read back');
 assert(sum(readback(1:32) ~= value) == 0, 'Wrong array read back')
 clear value readback register_size
+value = single(1:32) / 4;
+m.write('','AREA_DMAABLE', value);
+readback = m.read('','AREA_DMAABLE');
+assert(sum(readback(1:32) ~= round(value)) == 0, 'Wrong array read back')
+clear value readback
+
+value = logical(mod(1:32, 2));
+m.write('','AREA_DMAABLE', value);
+readback = m.read('','AREA_DMAABLE');
+assert(sum(readback(1:32) ~= value) == 0, 'Wrong array read back')
+clear value readback
+
 %% Test the readback of an array with offset
 
 value = 1:1024;
@@ -142,3 +154,45 @@ clear value readbback register_size elements
 %% Test the write of error or bad values
 
 check_error(@()m.write('','AREA_DMAABLE',0,-1), 'Illegal offset excepted');
+
+%% Test the write through register handles
+
+h = m.resolve('','WORD_USER');
+m.write_h(h, 17);
+assert(m.read_h(h) == 17, 'Wrong value read back through handle');
+check_error(@()m.write_h(h, [1 2]), 'Illegal number of elements excepted');
+clear h
+
+%% Test the raw write with fixed point conversion
+
+m.write_raw('', 'AREA_DMAABLE_FIXEDPOINT16_3', [-1.5 2.25 5000], 0, true, 16, 3);
+assert(isequal(m.read('', 'AREA_DMAABLE_FIXEDPOINT16_3', 0, 3), [-1.5 2.25 4095.875]), 'Wrong fixed point values written');
+m.write_raw('', 'WORD_USER', 82);
+assert(m.read_raw('', 'WORD_USER') == 82, 'Wrong raw value written');
+m.write_raw('', 'WORD_USER', 4294967295);
+assert(m.read_raw('', 'WORD_USER') == -1, 'Wrong unsigned raw value written');
+check_error(@()m.write_raw('', 'WORD_USER', NaN), 'NaN raw value excepted');
+check_error(@()m.write_raw('', 'WORD_USER', 2^32), 'Out of range raw value excepted');
+check_error(@()m.write_raw('', 'WORD_USER', -2^31 - 1), 'Out of range raw value excepted');
+check_error(@()m.write_raw('', 'WORD_USER', 1.5), 'Fractional raw value excepted');
+
+%% Test the batched write with read back
+
+report = m.write_many({{'', 'WORD_CLK_MUX', [4 3 2 1]}, {'', 'AREA_DMAABLE', 1:5, 10}, {'', 'WORD_USER', true}});
+assert(isempty(report), 'Report without verification must be empty');
+assert(isequal(m.read('', 'WORD_CLK_MUX'), [4 3 2 1]), 'Wrong array written');
+assert(isequal(m.read('', 'AREA_DMAABLE', 10, 5), 1:5), 'Wrong array written with offset');
+assert(m.read('', 'WORD_USER') == 1, 'Wrong logical written');
+
+% 10.3 is not representable with 3 fractional bits and reads back as 10.25
+report = m.write_many({{'', 'WORD_CLK_MUX', int32([1 2 3 4])}, {'', 'WORD_USER', 10.3}}, true);
+assert(numel(report) == 2, 'Wrong number of report entries');
+assert(report(1).mismatches == 0 && isempty(report(1).indices), 'Unexpected mismatch');
+assert(isequal(report(1).readback, [1 2 3 4]), 'Wrong array read back');
+assert(report(2).mismatches == 1 && report(2).indices == 1 && report(2).readback == 10.25, 'Mismatch not reported');
+assert(strcmp(report(2).register, '/WORD_USER'), 'Wrong register name in the report');
+
+check_error(@()m.write_many({{'', 'WORD_USER'}}), 'Missing value excepted');
+check_error(@()m.write_many({{'', 'WORD_CLK_MUX', [1 2], -1}}), 'Illegal offset excepted');
+check_error(@()m.write_many({{'', 'WORD_CLK_MUX', [1 2 3 4 5]}}), 'Too many elements excepted');
+clear report